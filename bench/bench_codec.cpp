@@ -0,0 +1,132 @@
+//lang::Cpp
+
+#include <chrono>
+#include <vector>
+#include "../src/application.h"
+#include "../src/dataframe.h"
+
+// The text file whose words make up the first frame
+#define WORDS_FILE "data/100k.txt"
+// The commits file used by the Linus demo, if it has been downloaded
+#define COMMITS_FILE "data/commits.ltgt"
+// Where a stand-in for the commits file is written when the real one is missing
+#define FAKE_COMMITS_FILE "/tmp/eau2_bench_commits.ltgt"
+// The number of rows in the stand-in commits file
+#define FAKE_COMMITS_ROWS 200000
+// The number of times every value is compressed and decompressed
+#define REPEATS 5
+
+/**
+ * Measures the compression ratio and speed of the value codec on the chunks of two frames: the
+ * words of data/100k.txt (as in the word count demo) and the commits table of the Linus demo. The
+ * frames are built in a single node store with compression off, and then every value in its map
+ * is compressed and decompressed on its own, the way the store does it.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+
+/** Returns the number of milliseconds since the given time point. */
+double since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+/** Builds a frame with one string column holding every word of the given file. */
+void load_words(KDStore* kd, const char* path) {
+    FILE* f = fopen(path, "r");
+    kd->exit_if_not(f != nullptr, "Could not open the words file");
+    std::vector<String*> words;
+    char word[512];
+    while (fscanf(f, "%511s", word) == 1) words.push_back(new String(word));
+    fclose(f);
+    Key k("words", 0);
+    // The frame takes ownership of the words
+    delete DataFrame::fromStringArray(&k, kd, words.size(), words.data());
+}
+
+/**
+ * Returns the path of a commits file in the Linus demo's format. If the real one has not been
+ * downloaded, writes a stand-in with the same shape: three int columns of author, committer, and
+ * project ids, where most commits are by a small set of users.
+ */
+const char* commits_path() {
+    FILE* f = fopen(COMMITS_FILE, "r");
+    if (f != nullptr) {
+        fclose(f);
+        return COMMITS_FILE;
+    }
+    f = fopen(FAKE_COMMITS_FILE, "w");
+    unsigned x = 42;
+    for (size_t i = 0; i < FAKE_COMMITS_ROWS; i++) {
+        int ids[3];
+        for (size_t j = 0; j < 3; j++) {
+            x = x * 1103515245 + 12345;
+            size_t range = (x >> 8) % 4 == 0 ? 100000 : 2000;
+            x = x * 1103515245 + 12345;
+            ids[j] = (x >> 8) % range;
+        }
+        fprintf(f, "<%d> <%d> <%d>\n", ids[0], ids[1], ids[2]);
+    }
+    fclose(f);
+    return FAKE_COMMITS_FILE;
+}
+
+/** Compresses and decompresses every value in the given store's map and prints the results. */
+void measure(const char* name, KVStore* kv) {
+    Vector values;
+    for (size_t s = 0; s < kv->map_.shards(); s++) {
+        Map* m = kv->map_.shards_[s];
+        for (size_t b = 0; b < m->capacity_; b++) {
+            for (size_t i = 0; i < m->items_[b].vals_.size(); i++)
+                values.append(m->items_[b].vals_.get(i)->clone());
+        }
+    }
+    size_t raw = 0;
+    size_t packed = 0;
+    double compress_ms = 0;
+    double decompress_ms = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        Blob* v = dynamic_cast<Blob*>(values.get(i));
+        raw += v->size();
+        char* c = nullptr;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < REPEATS; r++) {
+            delete[] c;
+            c = Codec::compress(v->c_str(), v->size());
+        }
+        compress_ms += since(start);
+        if (c == nullptr) {
+            packed += v->size();
+            continue;
+        }
+        packed += strlen(c);
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < REPEATS; r++) delete[] Codec::decompress(c);
+        decompress_ms += since(start);
+        delete[] c;
+    }
+    double mb = raw * (double)REPEATS / (1024 * 1024);
+    printf("%-8s %5zu values  %9zu -> %9zu bytes (%.2fx)  compress %7.1f MB/s  decompress "
+        "%7.1f MB/s\n", name, values.size(), raw, packed, (double)raw / packed,
+        mb / (compress_ms / 1000), mb / (decompress_ms / 1000));
+}
+
+int main(int argc, char** argv) {
+    KDStore* words = new KDStore(0, 1);
+    load_words(words, WORDS_FILE);
+    measure("100k.txt", words->get_kv());
+    words->done();
+    delete words;
+
+    KDStore* commits = new KDStore(0, 1);
+    const char* path = commits_path();
+    Key k("commits", 0);
+    char len[] = "1000000000";
+    delete DataFrame::fromFile(path, &k, commits, len);
+    measure("commits", commits->get_kv());
+    if (path != COMMITS_FILE) printf("(commits is a stand-in, make linus fetches the real one)\n");
+    commits->done();
+    delete commits;
+    return 0;
+}
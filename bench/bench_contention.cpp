@@ -0,0 +1,90 @@
+//lang::Cpp
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../src/kvstore.h"
+
+// The number of keys in the store
+#define KEYS 1024
+// The size in bytes of each value
+#define VALUE_SIZE 1024
+// The number of operations that each thread performs
+#define OPS 50000
+// One out of every this many operations is a put, the rest are gets
+#define PUT_EVERY 10
+
+/**
+ * Measures how local gets and puts on a single KVStore scale with the number of threads hitting
+ * it at once, first with the whole map behind one lock and then with the map split into the
+ * default number of shards.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+
+/** Returns the number of milliseconds since the given time point. */
+double since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+/** Returns a new value of VALUE_SIZE bytes. */
+char* make_value() {
+    char* v = new char[VALUE_SIZE + 1];
+    memset(v, 'x', VALUE_SIZE);
+    v[VALUE_SIZE] = '\0';
+    return v;
+}
+
+/** Mixes gets and puts over the given keys, starting at a different key on every thread. */
+void worker(KVStore* kv, Key** keys, size_t seed) {
+    size_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < OPS; i++) {
+        // A cheap pseudo-random walk over the keys
+        x = x * 6364136223846793005u + 1442695040888963407u;
+        Key* k = keys[(x >> 33) % KEYS];
+        if (i % PUT_EVERY == 0) {
+            kv->put(*k, make_value());
+        } else {
+            kv->get(*k);
+        }
+    }
+}
+
+/** Runs the workload on a store with the given number of shards, for each thread count. */
+void run(size_t shards, Key** keys) {
+    KVConfig cfg;
+    cfg.map_shards_ = shards;
+    KVStore* kv = new KVStore(0, 1, cfg);
+    for (size_t i = 0; i < KEYS; i++) kv->put(*keys[i], make_value());
+    // One untimed pass so that the allocator is warm before the first timed run
+    worker(kv, keys, 0);
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> ts;
+        for (size_t t = 0; t < threads; t++) ts.push_back(std::thread(worker, kv, keys, t));
+        for (size_t t = 0; t < threads; t++) ts[t].join();
+        double elapsed = since(start);
+        printf("%2zu shards  %zu threads  %.1fms (%.0f ops/s)\n", shards, threads, elapsed,
+            threads * OPS / (elapsed / 1000));
+    }
+    kv->shutdown();
+    delete kv;
+}
+
+int main(int argc, char** argv) {
+    Key** keys = new Key*[KEYS];
+    Key base("contention", 0);
+    KeyBuff kbuf(&base);
+    for (size_t i = 0; i < KEYS; i++) {
+        kbuf.c(i);
+        keys[i] = kbuf.get(0);
+    }
+    run(1, keys);
+    run(DEFAULT_MAP_SHARDS, keys);
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    for (size_t i = 0; i < KEYS; i++) delete keys[i];
+    delete[] keys;
+    return 0;
+}
@@ -0,0 +1,185 @@
+//lang::Cpp
+
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "../src/kvstore.h"
+
+// The number of round trips timed for each operation
+#define ROUNDS 2000
+// The number of threads that issue gets at the same time in the pipelined run
+#define THREADS 8
+// The number of back to back pipelined runs, to check that throughput does not degrade over time
+#define RUNS 5
+// The size in bytes of the value moved in the large message run
+#define BIG_SIZE (16 * 1024 * 1024)
+// The number of round trips timed in the large message run
+#define BIG_ROUNDS 10
+
+/**
+ * Measures the loopback round trip latency of remote KVStore operations. Two KVStores are started
+ * in this process (nodes 0 and 1) and node 1 repeatedly puts to and gets from a key that is homed
+ * on node 0.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+
+/** Prints the mean, median, 99th percentile, and max of the given latencies in microseconds. */
+void report(const char* name, double* lat, size_t n) {
+    std::sort(lat, lat + n);
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) sum += lat[i];
+    printf("%-12s mean %9.1fus  p50 %9.1fus  p99 %9.1fus  max %9.1fus\n", name, sum / n,
+        lat[n / 2], lat[(n * 99) / 100], lat[n - 1]);
+}
+
+/** Issues ROUNDS gets for the given key from the given KVStore. */
+void get_loop(KVStore* kv, Key* k) {
+    for (size_t i = 0; i < ROUNDS; i++) {
+        Blob v = kv->get(*k);
+        assert(strcmp(v.c_str(), "I{12345}") == 0);
+    }
+}
+
+/** Returns the number of microseconds since the given time point. */
+double since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+/**
+ * Starts nodes 0 and 1 of a two node cluster in this process. Each node's constructor waits for
+ * the other one, so they are started at the same time.
+ */
+void start_pair(KVConfig cfg, KVStore** server, KVStore** client) {
+    std::thread t([&]() { *server = new KVStore(0, 2, cfg); });
+    *client = new KVStore(1, 2, cfg);
+    t.join();
+}
+
+/** Stops both nodes of a pair through the done barrier and deletes them. */
+void stop_pair(KVStore* server, KVStore* client) {
+    std::thread t(&KVStore::done, server);
+    client->done();
+    t.join();
+    delete client;
+    delete server;
+}
+
+/**
+ * Times remote gets and large put+gets between a fresh pair of nodes, with nodes on this host
+ * talking over Unix sockets or over loopback TCP.
+ */
+void time_transport(bool local, double* lat) {
+    Sys s;
+    KVConfig cfg;
+    cfg.local_transport_ = local;
+    KVStore* server;
+    KVStore* client;
+    start_pair(cfg, &server, &client);
+    const char* name = local ? "unix" : "tcp";
+    Key k("transport", 0);
+    client->put(k, s.duplicate("I{12345}"));
+    for (size_t i = 0; i < ROUNDS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        client->get(k);
+        lat[i] = since(start);
+    }
+    printf("%-5s", name);
+    report("get", lat, ROUNDS);
+    char* big = new char[BIG_SIZE + 1];
+    memset(big, 'x', BIG_SIZE);
+    big[BIG_SIZE] = '\0';
+    for (size_t i = 0; i < BIG_ROUNDS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        client->put(k, s.duplicate(big));
+        client->get(k);
+        lat[i] = since(start);
+    }
+    delete[] big;
+    printf("%-5s", name);
+    report("16MB put+get", lat, BIG_ROUNDS);
+    stop_pair(server, client);
+}
+
+int main(int argc, char** argv) {
+    Sys s;
+    KVStore* server;
+    KVStore* client;
+    std::chrono::steady_clock::time_point up = std::chrono::steady_clock::now();
+    start_pair(KVConfig(), &server, &client);
+    printf("startup      %.1fms\n", since(up) / 1000);
+    Key k("bench", 0);
+    double* lat = new double[ROUNDS];
+
+    for (size_t i = 0; i < ROUNDS; i++) {
+        char* v = s.duplicate("I{12345}");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        client->put(k, v);
+        lat[i] = since(start);
+    }
+    report("remote put", lat, ROUNDS);
+
+    // Puts that do not wait for their Acks, up to the window, and then one flush at the end
+    std::chrono::steady_clock::time_point async_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ROUNDS; i++) client->put_async(k, s.duplicate("I{12345}"));
+    client->flush();
+    double async_elapsed = since(async_start);
+    printf("async put    %zu puts in %.1fms (%.0f puts/s, window %zu)\n", (size_t)ROUNDS,
+        async_elapsed / 1000, ROUNDS / (async_elapsed / 1e6), client->cfg_.put_window_);
+
+    for (size_t i = 0; i < ROUNDS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Blob v = client->get(k);
+        lat[i] = since(start);
+        assert(strcmp(v.c_str(), "I{12345}") == 0);
+    }
+    report("remote get", lat, ROUNDS);
+
+    for (size_t i = 0; i < ROUNDS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        client->wait_and_get(k);
+        lat[i] = since(start);
+    }
+    report("remote wag", lat, ROUNDS);
+
+    // Multi-megabyte values, like the serialized chunks of a large DataFrame
+    char* big = new char[BIG_SIZE + 1];
+    memset(big, 'x', BIG_SIZE);
+    big[BIG_SIZE] = '\0';
+    Key big_k("big", 0);
+    for (size_t i = 0; i < BIG_ROUNDS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        client->put(big_k, s.duplicate(big));
+        Blob v = client->get(big_k);
+        lat[i] = since(start);
+        assert(v.size() == BIG_SIZE);
+    }
+    delete[] big;
+    report("16MB put+get", lat, BIG_ROUNDS);
+
+    // Many threads issuing gets through the same socket at once, several times in a row
+    for (size_t r = 0; r < RUNS; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREADS; i++) threads.push_back(std::thread(get_loop, client, &k));
+        for (size_t i = 0; i < THREADS; i++) threads[i].join();
+        double elapsed = since(start);
+        printf("run %zu: %zu threads  %zu gets in %.1fms (%.0f gets/s)\n", r, (size_t)THREADS,
+            (size_t)(THREADS * ROUNDS), elapsed / 1000, THREADS * ROUNDS / (elapsed / 1e6));
+    }
+    printf("server pool: %zu workers  %zu tasks  max queue depth %zu\n", server->pool_->size(),
+        server->pool_->completed(), server->pool_->max_queue_depth());
+
+    std::chrono::steady_clock::time_point down = std::chrono::steady_clock::now();
+    stop_pair(server, client);
+    printf("shutdown     %.1fms\n", since(down) / 1000);
+
+    // The same node pair over each transport
+    time_transport(false, lat);
+    time_transport(true, lat);
+    delete[] lat;
+    return 0;
+}
@@ -0,0 +1,70 @@
+//lang::Cpp
+
+#include "../src/cluster.h"
+#include "../src/dataframe.h"
+
+// The number of values in the frame that each node builds
+#define ROWS 200000
+// The most nodes that a cluster is timed with
+#define MAX_NODES 32
+// The worker threads of each node, kept low since every node of the cluster is in this process
+#define HANDLERS 2
+// The one way latency of the simulated network, in microseconds
+#define NET_LATENCY_US 100
+// The bandwidth of each connection of the simulated network, in bytes per second
+#define NET_BYTES_PER_SEC (1000 * 1000 * 1000)
+
+/**
+ * Measures how the same per-node work scales from 1 to 32 nodes, all run in this process by the
+ * in-process cluster harness. Every node builds a frame of ROWS ints whose chunks are spread
+ * over the whole cluster, and then reads the frame built by the node after it from start to
+ * end, so each node moves as much data at every size. The cluster is timed on a free network and
+ * on a simulated one with some latency and a bandwidth limit.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+
+/** The part of the benchmark that every node runs. */
+void node(size_t idx, size_t nodes, KVConfig cfg) {
+    KDStore kd(idx, nodes, cfg);
+    int* vals = new int[ROWS];
+    for (size_t i = 0; i < ROWS; i++) vals[i] = i;
+    char name[16];
+    snprintf(name, sizeof(name), "part-%zu", idx);
+    Key mine(name, idx);
+    delete DataFrame::fromIntArray(&mine, &kd, ROWS, vals);
+    delete[] vals;
+    size_t next = (idx + 1) % nodes;
+    snprintf(name, sizeof(name), "part-%zu", next);
+    Key theirs(name, next);
+    DataFrame* df = kd.wait_and_get(theirs);
+    long sum = 0;
+    for (size_t i = 0; i < ROWS; i++) sum += df->get_int(0, i);
+    kd.exit_if_not(sum == (long)ROWS * (ROWS - 1) / 2, "Read back the wrong values");
+    delete df;
+    kd.done();
+}
+
+/** Times the benchmark on clusters of 1 to MAX_NODES nodes that use the given settings. */
+void run(const char* label, KVConfig cfg) {
+    for (size_t nodes = 1; nodes <= MAX_NODES; nodes *= 2) {
+        Cluster cluster(nodes, cfg);
+        double elapsed = cluster.run([nodes](size_t idx, KVConfig cfg) {
+            node(idx, nodes, cfg);
+        });
+        printf("%-8s %2zu nodes  %8.1fms  (%.0f rows/s per node)\n", label, nodes, elapsed,
+            ROWS / (elapsed / 1000));
+    }
+}
+
+int main(int argc, char** argv) {
+    KVConfig cfg;
+    cfg.handler_threads_ = HANDLERS;
+    run("free", cfg);
+    cfg.net_latency_us_ = NET_LATENCY_US;
+    cfg.net_bytes_per_sec_ = NET_BYTES_PER_SEC;
+    run("lan", cfg);
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    return 0;
+}
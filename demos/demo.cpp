@@ -13,8 +13,8 @@ public:
     Key* check;
 
     Demo(size_t idx, size_t num_nodes) : 
-        Application(idx, num_nodes), main(new Key("main", 0)), verify(new Key("verif", 0)), 
-        check(new Key("ck", 0)) {
+        Application(idx, num_nodes), main(kd_.place("main")), verify(kd_.place("verif")), 
+        check(kd_.place("ck")) {
         run_();
     }
 
@@ -30,6 +30,7 @@ public:
             case 1:   counter();    break;
             case 2:   summarizer();
         }
+        done();
     }
 
     void producer() {
@@ -56,7 +57,6 @@ public:
         DataFrame* result = kd_.wait_and_get(*verify);
         DataFrame* expected = kd_.wait_and_get(*check);
         pln(expected->get_float(0,0)==result->get_float(0,0) ? "SUCCESS":"FAILURE", this_node());
-        done();
         delete result; delete expected;
     }
 };
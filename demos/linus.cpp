@@ -58,6 +58,28 @@ public:
 
   size_t num_true() { return true_; }
 
+  /** Returns the number of elements and then each of them, as "{n}" fields
+   *  that the caller owns. */
+  const char* serialize() {
+    size_t n = 0; // true_ also counts repeated set()s
+    for (size_t i = 0; i < size_; i++)
+      if (vals_[i]) n++;
+    StrBuff buff;
+    buff.c("{").c(n).c("}");
+    for (size_t i = 0; i < size_; i++)
+      if (vals_[i]) buff.c("{").c(i).c("}");
+    return buff.c_str();
+  }
+
+  /** Adds the elements of a set serialized by serialize() to this one, and
+   *  returns how many there were. */
+  size_t add_all(const char* serial) {
+    Deserializer ds(serial);
+    size_t n = ds.deserialize_size_t();
+    for (size_t i = 0; i < n; i++) set(ds.deserialize_size_t());
+    return n;
+  }
+
   /** Performs set union in place. */
   void union_(Set& from) {
     for (size_t i = 0; i < from.size_; i++) 
@@ -186,11 +208,10 @@ public:
   Set* pSet; // projects of collaborators
   size_t num_nodes;
   char* len; // number of byes to read from the datafiles
-  char* key_str; // temporary buffer that holds key strings
-  Key* linus_key; // the key to the df containing Linus' id
+  Set* newUsers; // the users tagged in the previous round
 
-  Linus(size_t idx, size_t nodes, char* len): Application(idx, nodes), num_nodes(nodes), len(len),
-    linus_key(new Key("users-0-0", 0)) {
+  Linus(size_t idx, size_t nodes, char* len, KVConfig cfg = KVConfig()):
+    Application(idx, nodes, cfg), num_nodes(nodes), len(len) {
     run_();
   }
 
@@ -198,32 +219,34 @@ public:
     delete projects;
     delete users;
     delete commits;
-    delete linus_key;
     delete uSet;
     delete pSet;
+    delete newUsers;
   }
 
   /** Compute DEGREES of Linus.  */
   void run_() override {
     readInput();
     for (size_t i = 0; i < DEGREES; i++) step(i);
-    if (this_node() == 0) {
-      sleep(3);
-      done();
-    }
+    done();
   }
 
   /** Node 0 reads three files, cointainng projects, users and commits, and
-   *  creates thre dataframes. All other nodes wait and load the three
-   *  dataframes. Once we know the size of users and projects, we create
-   *  sets of each (uSet and pSet). We also output a data frame with a the
-   *  'tagged' users. At this point the dataframe consists of only
-   *  Linus. **/
+   *  creates thre dataframes, which it then hands to all other nodes down a
+   *  tree. Once we know the size of users and projects, we create sets of
+   *  each (uSet and pSet). The users tagged so far consist of only Linus. **/
   void readInput() {
     Key pK("projs", 0);
     Key uK("usrs", 0);
     Key cK("comts", 0);
-    if (this_node() == 0) {
+    projects = users = commits = nullptr;
+    if (this_node() == 0 && kd_.get_kv()->has_local(cK)) {
+      // A restarted node 0 got the dataframes back from its journal
+      pln("Restored from the journal");
+      projects = kd_.get(pK);
+      users = kd_.get(uK);
+      commits = kd_.get(cK);
+    } else if (this_node() == 0) {
       pln("Reading...");
       projects = DataFrame::fromFile(PROJ, &pK, &kd_, len);
       p("    ").p(projects->nrows()).pln(" projects");
@@ -231,15 +254,14 @@ public:
       p("    ").p(users->nrows()).pln(" users");
       commits = DataFrame::fromFile(COMM, &cK, &kd_, len);
       p("    ").p(commits->nrows()).pln(" commits");
-      // This dataframe contains the id of Linus.
-      delete DataFrame::fromIntScalar(linus_key, &kd_, LINUS);
-    } else {
-      projects = dynamic_cast<DataFrame*>(kd_.wait_and_get(pK));
-      users = dynamic_cast<DataFrame*>(kd_.wait_and_get(uK));
-      commits = dynamic_cast<DataFrame*>(kd_.wait_and_get(cK));
     }
+    projects = kd_.broadcast(pK, projects);
+    users = kd_.broadcast(uK, users);
+    commits = kd_.broadcast(cK, commits);
     uSet = new Set(users);
     pSet = new Set(projects);
+    newUsers = new Set(users);
+    newUsers->set(LINUS);
   }
 
  /** Performs a step of the linus calculation. It operates over the three
@@ -247,73 +269,41 @@ public:
   *  projects, and the users added in the previous round. */
   void step(int stage) {
     p("Stage ", this_node()).pln(stage, this_node());
-    // Key of the shape: users-stage-0
-    key_str = StrBuff("users-").c(stage).c("-0").c_str();
-    Key uK(key_str, 0);
-    delete[] key_str;
-    // A df with all the users added on the previous round
-    DataFrame* newUsers = dynamic_cast<DataFrame*>(kd_.wait_and_get(uK));    
-    Set delta(users);
-    SetUpdater upd(delta);  
-    newUsers->map(upd); // all of the new users are copied to delta.
-    delete newUsers;
-    ProjectsTagger ptagger(delta, *pSet, projects);
-    commits->local_map(ptagger); // marking all projects touched by delta
-    merge(ptagger.newProjects, "projects-", stage);
+    ProjectsTagger ptagger(*newUsers, *pSet, projects);
+    commits->local_map(ptagger); // marking all projects touched by the new users
+    merge(ptagger.newProjects);
     pSet->union_(ptagger.newProjects); // 
     UsersTagger utagger(ptagger.newProjects, *uSet, users);
     commits->local_map(utagger);
-    merge(utagger.newUsers, "users-", stage + 1);
+    merge(utagger.newUsers);
     uSet->union_(utagger.newUsers);
+    // The users tagged in this round are where the next one starts
+    delete newUsers;
+    newUsers = new Set(users);
+    newUsers->union_(utagger.newUsers);
     p("    after stage ", this_node()).p(stage, this_node()).pln(":", this_node());
     p("        tagged projects: ", this_node()).pln(pSet->num_true(), this_node());
     p("        tagged users: ", this_node()).pln(uSet->num_true(), this_node());
   }
 
-  /** Gather updates to the given set from all the nodes in the systems.
-   * The union of those updates is then published as dataframe.  The key
-   * used for the otuput is of the form "name-stage-0" where name is either
-   * 'users' or 'projects', stage is the degree of separation being
-   * computed.
+  /** Gather updates to the given set from all the nodes in the systems, so
+   * that every node ends up with their union. The deltas are gathered and
+   * handed back out along a tree, which takes log(nodes) rounds instead of
+   * every node trading its delta with the master node in turn.
    */ 
-  void merge(Set& set, char const* name, int stage) {
-    if (this_node() == 0) {
-      for (size_t i = 1; i < num_nodes; ++i) {
-        key_str = StrBuff(name).c(stage).c("-").c(i).c_str();
-        Key nK(key_str, 0);
-        delete[] key_str;
-        DataFrame* delta = dynamic_cast<DataFrame*>(kd_.wait_and_get(nK));
-        p("    received delta of ", this_node()).p(delta->nrows())
-          .p(" elements from node ", this_node()).pln(i);
-        SetUpdater upd(set);
-        delta->map(upd);
-        delete delta;
-      }
-      p("    storing ", this_node()).p(set.num_true(), this_node())
-        .pln(" merged elements", this_node());
-      SetWriter writer(set);
-      key_str = StrBuff(name).c(stage).c("-0").c_str();
-      Key k(key_str, 0);
-      delete[] key_str;
-      delete DataFrame::fromVisitor(&k, &kd_, "I", writer);
-    } else {
-      p("    sending ", this_node()).p(set.num_true(), this_node())
-        .pln(" elements to master node", this_node());
-      SetWriter writer(set);
-      key_str = StrBuff(name).c(stage).c("-").c(this_node()).c_str();
-      Key k(key_str, 0);
-      delete[] key_str;
-      delete DataFrame::fromVisitor(&k, &kd_, "I", writer);
-      key_str = StrBuff(name).c(stage).c("-0").c_str();
-      Key mK(key_str, 0);
-      delete[] key_str;
-      DataFrame* merged = dynamic_cast<DataFrame*>(kd_.wait_and_get(mK));
-      p("    receiving ", this_node()).p(merged->nrows(), this_node())
-        .pln(" merged elements", this_node());
-      SetUpdater upd(set);
-      merged->map(upd);
-      delete merged;
+  void merge(Set& set) {
+    p("    sending ", this_node()).p(set.num_true(), this_node())
+      .pln(" elements to the other nodes", this_node());
+    Blob* deltas = kd_.get_kv()->allgather(set.serialize());
+    for (size_t i = 0; i < num_nodes; ++i) {
+      if (i == this_node()) continue;
+      size_t n = set.add_all(deltas[i].c_str());
+      p("    received delta of ", this_node()).p(n)
+        .p(" elements from node ", this_node()).pln(i);
     }
+    delete[] deltas;
+    p("    merged ", this_node()).p(set.num_true(), this_node())
+      .pln(" elements", this_node());
   }
 }; // Linus
 
@@ -324,9 +314,11 @@ int main(int argc, char** argv) {
   // number of byes to read from the datafiles
   // defaults to 0, in which case the entire files will be read
   char* len = 0;
+  // -d keeps each node's data in the given directory, so that a rerun skips reading the files
+  KVConfig cfg;
   int c;
 
-  while ((c = getopt(argc, argv, "i:n:l:")) != -1) {
+  while ((c = getopt(argc, argv, "i:n:l:d:")) != -1) {
     switch (c) {
       case 'i':
         node_idx = atoi(optarg);
@@ -337,11 +329,14 @@ int main(int argc, char** argv) {
       case 'l':
         len = optarg;
         break;
+      case 'd':
+        cfg.data_dir_ = optarg;
+        break;
       default:
         fprintf(stderr, "Invalid command line args.");
         return 1;
     }
   }
 
-  Linus(node_idx, num_nodes, len);
+  Linus(node_idx, num_nodes, len, cfg);
 }
\ No newline at end of file
@@ -147,6 +147,43 @@ public:
   bool done() { return seen == map_.size(); }
 };
  
+/****************************************************************************
+ * Word counts travel between nodes as text, one "word count" line per word.
+ * Words never hold whitespace, so the lines split back apart cleanly.
+ ****************************************************************************/
+/** Adds the counts in the given text to the map. */
+void add_counts(const char* counts, SIMap& map) {
+  const char* line = counts;
+  while (*line != 0) {
+    const char* space = strchr(line, ' ');
+    String word(line, space - line);
+    size_t n = strtoul(space + 1, nullptr, 10);
+    Num* num = new Num(map.contains(word) ? map.get(word)->v + n : n);
+    map.put(word, num);
+    line = strchr(space, '\n') + 1;
+  }
+}
+
+/** Returns the counts in the map as text, which the caller owns. */
+const char* write_counts(SIMap& map) {
+  StrBuff buff;
+  for (size_t i = 0; i < map.capacity_; i++) {
+    for (size_t j = 0; j < map.items_[i].keys_.size(); j++) {
+      buff.c(*(String*)map.items_[i].keys_.get(j)).c(" ");
+      buff.c(((Num*)map.items_[i].vals_.get(j))->v).c("\n");
+    }
+  }
+  return buff.c_str();
+}
+
+/** Combines the counts of two parts of the cluster, for KVStore::reduce(). */
+const char* combine_counts(const char* a, const char* b) {
+  SIMap map;
+  add_counts(a, map);
+  add_counts(b, map);
+  return write_counts(map);
+}
+
 /****************************************************************************
  * Calculate a word count for given file:
  *   1) read the data (single node)
@@ -156,19 +193,16 @@ public:
 class WordCount: public Application {
 public:
   Key in;
-  Key* map;
-  KeyBuff kbuf;
   SIMap all;
   char* file;
   size_t num_nodes;
+  const char* counts; // this node's word counts, as text
  
   WordCount(size_t idx, size_t num_nodes, char* file):
-    Application(idx, num_nodes), in("data", 0), map(new Key("wc-map-",0)), kbuf(map), file(file),
-    num_nodes(num_nodes) { 
+    Application(idx, num_nodes), in("data", 0), file(file), num_nodes(num_nodes),
+    counts(nullptr) { 
       run_();    
   }
-
-  ~WordCount() { delete map; }
  
   /** The master nodes reads the input, then all of the nodes count. */
   void run_() override {
@@ -178,18 +212,10 @@ public:
     }
     local_count();
     reduce();
+    done();
   }
  
-  /** Returns a key for given node.  These keys are homed on master node
-   *  which then joins them one by one. */
-  Key* mk_key(size_t idx) {
-      Key * k = kbuf.c(idx).get(0);
-      p("Node ", this_node()).p(this_node(), this_node()).p(": Created key ", this_node())
-        .pln(k->get_keystring()->c_str(), this_node());
-      return k;
-  }
- 
-  /** Compute word counts on the local node and build a data frame. */
+  /** Compute word counts on the local node. */
   void local_count() {
     DataFrame* words = (kd_.wait_and_get(in));
     p("Node ", this_node()).p(this_node(), this_node())
@@ -198,34 +224,19 @@ public:
     Adder add(map);
     words->local_map(add);
     delete words;
-    Summer cnt(map);
-    Key* local = mk_key(this_node());
-    delete DataFrame::fromVisitor(local, &kd_, "SI", cnt);
-    delete local;
+    counts = write_counts(map);
   }
  
-  /** Merge the data frames of all nodes */
+  /** Merge the counts of all nodes pairwise up a tree, which ends on node 0
+   *  after log(nodes) rounds instead of node 0 reading every node's counts. */
   void reduce() {
+    Blob merged = kd_.get_kv()->reduce(counts, combine_counts);
+    counts = nullptr;
     if (this_node() != 0) return;
     pln("Node 0: reducing counts...", this_node());
     SIMap map;
-    Key* own = mk_key(0);
-    merge(kd_.get(*own), map);
-    for (size_t i = 1; i < num_nodes; ++i) { // merge other nodes
-      Key* ok = mk_key(i);
-      merge(kd_.wait_and_get(*ok), map);
-      delete ok;
-    }
+    add_counts(merged.c_str(), map);
     p("Different words: ", this_node()).pln(map.size(), this_node());
-    delete own;
-    sleep(1);
-    done();
-  }
- 
-  void merge(DataFrame* df, SIMap& m) {
-    Adder add(m);
-    df->map(add);
-    delete df;
   }
 }; // WordcountDemo
 
@@ -18,7 +18,8 @@ public:
     KDStore kd_;
 
     /** Constructor */
-    Application(size_t idx, size_t nodes) : idx_(idx), kd_(idx, nodes) { }
+    Application(size_t idx, size_t nodes, KVConfig cfg = KVConfig()) : idx_(idx),
+        kd_(idx, nodes, cfg) { }
 
     /** Runs the application on the current node. */
     virtual void run_() { }
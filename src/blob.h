@@ -0,0 +1,124 @@
+//lang::Cpp
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string.h>
+
+#include "object.h"
+
+/**
+ * The bytes of one value and the number of Blob handles that share them. Not exposed; only Blob
+ * creates and deletes these.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class BlobData_ {
+public:
+    // The number of handles that share the bytes
+    std::atomic<size_t> refs_;
+    // The null-terminated bytes, owned
+    char* bytes_;
+    // The number of bytes, not counting the terminator
+    size_t size_;
+    // Frees the bytes if they did not come from new[], for example if they are mapped from a file
+    std::function<void()> free_;
+
+    /** Constructor, takes ownership of the given bytes */
+    BlobData_(char* bytes, size_t size) : refs_(1), bytes_(bytes), size_(size) { }
+
+    /** Constructor for bytes that are freed by calling the given function */
+    BlobData_(char* bytes, size_t size, std::function<void()> free) : refs_(1), bytes_(bytes),
+        size_(size), free_(free) { }
+
+    /** Destructor */
+    ~BlobData_() {
+        if (free_) free_();
+        else delete[] bytes_;
+    }
+};
+
+/**
+ * A refcounted handle to an immutable, null-terminated value. Copying a Blob shares the bytes
+ * instead of copying them, and the bytes are deleted along with the last handle to them, so the
+ * KVStore can hand out the values in its map without copying them and still replace them while
+ * they are being read. A default-constructed Blob holds no value.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Blob : public Object {
+public:
+    // The shared bytes, or nullptr if this handle holds no value
+    BlobData_* data_;
+
+    /** Constructor for an empty handle */
+    Blob() : data_(nullptr) { }
+
+    /** Constructor that takes ownership of the given null-terminated value, which may be nullptr */
+    explicit Blob(const char* v) : data_(nullptr) {
+        if (v != nullptr) data_ = new BlobData_((char*)v, strlen(v));
+    }
+
+    /**
+     * Constructor for the given null-terminated bytes of the given length that were not
+     * allocated with new[]. The given function frees them once the last handle lets go.
+     */
+    Blob(char* bytes, size_t size, std::function<void()> free) :
+        data_(new BlobData_(bytes, size, free)) { }
+
+    /** Copy constructor, shares the other handle's bytes */
+    Blob(const Blob& other) : Object(), data_(other.data_) { retain_(); }
+
+    /** Makes this handle share the other handle's bytes, letting go of its own */
+    Blob& operator=(const Blob& other) {
+        if (other.data_ != data_) {
+            release_();
+            data_ = other.data_;
+            retain_();
+        }
+        return *this;
+    }
+
+    /** Destructor */
+    ~Blob() { release_(); }
+
+    /** Does this handle hold no value? */
+    bool empty() { return data_ == nullptr; }
+
+    /** Returns the value, or nullptr if there is none. It must not be modified or freed. */
+    char* c_str() { return data_ == nullptr ? nullptr : data_->bytes_; }
+
+    /** Returns the length of the value, not counting the terminator */
+    size_t size() { return data_ == nullptr ? 0 : data_->size_; }
+
+    /** Are the bytes freed by a function rather than held on the heap? */
+    bool external() { return data_ != nullptr && (bool)data_->free_; }
+
+    /** Returns the number of handles that share this handle's bytes, including this one */
+    size_t refs() { return data_ == nullptr ? 0 : data_->refs_.load(); }
+
+    /** Returns a copy of the value that the caller owns, or nullptr if there is none */
+    char* copy() {
+        if (data_ == nullptr) return nullptr;
+        char* res = new char[data_->size_ + 1];
+        memcpy(res, data_->bytes_, data_->size_ + 1);
+        return res;
+    }
+
+    /** Returns another handle to the same bytes */
+    Blob* clone() { return new Blob(*this); }
+
+    /** Adds this handle to the count of its bytes */
+    void retain_() {
+        if (data_ != nullptr) data_->refs_++;
+    }
+
+    /** Removes this handle from the count of its bytes, deleting them if it was the last one */
+    void release_() {
+        if (data_ != nullptr && --data_->refs_ == 0) delete data_;
+        data_ = nullptr;
+    }
+};
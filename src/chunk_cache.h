@@ -0,0 +1,132 @@
+//lang::Cpp
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "object.h"
+
+/**
+ * One entry in a ChunkCache. Not exposed; only ChunkCache creates these.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class CacheEntry_ {
+public:
+    // The key string of the chunk
+    std::string key_;
+    // The deserialized chunk, shared with every DistributedVector that is reading it
+    std::shared_ptr<Object> value_;
+    // The number of bytes that the chunk is charged against the budget
+    size_t size_;
+
+    /** Constructor */
+    CacheEntry_(const char* key, std::shared_ptr<Object> value, size_t size) : key_(key),
+        value_(value), size_(size) { }
+};
+
+/**
+ * A node-wide cache of deserialized DataFrame chunks that were fetched from other nodes, shared
+ * by every DataFrame on the node, so scanning the same remote data again costs neither a round
+ * trip nor a deserialization. Chunks are never changed once their DataFrame is stored, so
+ * entries only leave to stay within the byte budget, least recently used first.
+ *
+ * Chunks are handed out as shared_ptrs, so one that is evicted while a reader still has it stays
+ * alive until the reader lets go.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ChunkCache : public Object {
+public:
+    // The most bytes of chunks to keep, or 0 to cache nothing
+    size_t budget_;
+    // The number of bytes of chunks in the cache. Guarded by mtx_
+    size_t bytes_;
+    // The entries, most recently used first. Guarded by mtx_
+    std::list<CacheEntry_> lru_;
+    // Where each key's entry is in lru_. Guarded by mtx_
+    std::unordered_map<std::string, std::list<CacheEntry_>::iterator> index_;
+    // The lock that guards the entries
+    std::mutex mtx_;
+    // The number of lookups that found their chunk
+    std::atomic<size_t> hits_;
+    // The number of lookups that did not
+    std::atomic<size_t> misses_;
+    // The number of chunks dropped to stay within the budget
+    std::atomic<size_t> evictions_;
+
+    /** Constructor for a cache that holds up to the given number of bytes */
+    ChunkCache(size_t budget) : budget_(budget), bytes_(0), hits_(0), misses_(0),
+        evictions_(0) { }
+
+    /** Returns the chunk at the given key, or an empty pointer if it is not cached. */
+    std::shared_ptr<Object> get(const char* key) {
+        if (budget_ == 0) return std::shared_ptr<Object>();
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::unordered_map<std::string, std::list<CacheEntry_>::iterator>::iterator it =
+            index_.find(key);
+        if (it == index_.end()) {
+            misses_++;
+            return std::shared_ptr<Object>();
+        }
+        hits_++;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->value_;
+    }
+
+    /**
+     * Caches the given chunk at the given key, charging it the given number of bytes, and drops
+     * the least recently used chunks until the cache fits in its budget again. A chunk bigger
+     * than the whole budget is not cached.
+     */
+    void put(const char* key, std::shared_ptr<Object> value, size_t size) {
+        if (size > budget_) return;
+        std::lock_guard<std::mutex> lk(mtx_);
+        erase_locked_(key);
+        lru_.push_front(CacheEntry_(key, value, size));
+        index_[lru_.front().key_] = lru_.begin();
+        bytes_ += size;
+        while (bytes_ > budget_) {
+            bytes_ -= lru_.back().size_;
+            index_.erase(lru_.back().key_);
+            lru_.pop_back();
+            evictions_++;
+        }
+    }
+
+    /** Drops the chunk at the given key, if there is one. */
+    void erase(const char* key) {
+        if (budget_ == 0) return;
+        std::lock_guard<std::mutex> lk(mtx_);
+        erase_locked_(key);
+    }
+
+    /** Like erase(), for a caller that holds mtx_. */
+    void erase_locked_(const char* key) {
+        std::unordered_map<std::string, std::list<CacheEntry_>::iterator>::iterator it =
+            index_.find(key);
+        if (it == index_.end()) return;
+        bytes_ -= it->second->size_;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    /** Returns the number of bytes of chunks in the cache. */
+    size_t bytes() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return bytes_;
+    }
+
+    /** Returns the number of chunks in the cache. */
+    size_t size() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return lru_.size();
+    }
+};
@@ -0,0 +1,85 @@
+//lang::Cpp
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "application.h"
+
+// The port that the first in-process cluster's nodes are named by. Every cluster gets the next
+// one, so clusters in the same process never share addresses
+#define CLUSTER_FIRST_PORT 20000
+
+/**
+ * Runs every node of a cluster in this process, each on its own thread, connected by the
+ * in-process loopback transport (LoopbackTransport in src/transport.h) rather than by sockets
+ * bound to 127.0.0.x addresses. This makes it cheap to time the same work on 1 to 32 nodes from
+ * one benchmark, and the network cost settings in KVConfig (net_latency_us_, net_jitter_us_,
+ * net_bytes_per_sec_ and net_seed_) make the nodes see a slower network, with delays that a run
+ * with the same seed reproduces.
+ *
+ * Each node runs a function that is given its index and its config. The function builds its own
+ * KDStore or Application from them, does its part, and calls done() before it returns.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Cluster : public Object {
+public:
+    // The number of nodes
+    size_t nodes_;
+    // The settings shared by every node
+    KVConfig cfg_;
+    // The "host:port" that each node is named by, owned
+    std::vector<char*> addrs_;
+
+    /** Constructor for a cluster of the given number of nodes that all use the given settings */
+    Cluster(size_t nodes, KVConfig cfg = KVConfig()) : nodes_(nodes), cfg_(cfg) {
+        exit_if_not(nodes > 0 && nodes < 255, "A cluster has between 1 and 254 nodes");
+        size_t port = next_port_()++;
+        for (size_t i = 0; i < nodes_; i++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "127.0.0.%zu:%zu", i + 1, port);
+            addrs_.push_back(duplicate(buf));
+        }
+        cfg_.loopback_ = true;
+        cfg_.members_file_ = nullptr;
+        cfg_.server_address_ = addrs_[0];
+    }
+
+    /** Destructor */
+    ~Cluster() {
+        for (size_t i = 0; i < addrs_.size(); i++) delete[] addrs_[i];
+    }
+
+    /** Returns the port that the next cluster in this process is named by. */
+    static std::atomic<size_t>& next_port_() {
+        static std::atomic<size_t> port(CLUSTER_FIRST_PORT);
+        return port;
+    }
+
+    /** Returns the settings of the node with the given index. */
+    KVConfig config(size_t idx) {
+        KVConfig cfg = cfg_;
+        cfg.address_ = addrs_[idx];
+        return cfg;
+    }
+
+    /**
+     * Runs the given function as every node at once, and returns once all of them have.
+     *
+     * @return The time from starting the first node to the last one returning, in milliseconds
+     */
+    double run(std::function<void(size_t, KVConfig)> node) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nodes_; i++) threads.push_back(std::thread(node, i, config(i)));
+        for (size_t i = 0; i < nodes_; i++) threads[i].join();
+        std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+        return d.count();
+    }
+};
@@ -0,0 +1,177 @@
+//lang::Cpp
+
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+
+#include "object.h"
+
+// The first byte of every compressed value. Uncompressed values that happen to start with it are
+// always stored compressed, so a value is compressed exactly when it starts with this byte
+#define CODEC_MARKER '\x01'
+// The shortest match that is worth encoding
+#define CODEC_MIN_MATCH 4
+// The number of bits in the hash of the next CODEC_MIN_MATCH bytes used to find matches
+#define CODEC_HASH_BITS 14
+// The farthest back that a match may start
+#define CODEC_MAX_OFFSET (1 << 20)
+// Values shorter than this are not worth compressing
+#define CODEC_MIN_SIZE 64
+
+/**
+ * A small LZ77 block codec for the null-terminated values that the KVStore moves around, in the
+ * spirit of LZ4: a greedy compressor that finds matches through a hash table of recent
+ * positions, and a decompressor that is a tight copy loop.
+ *
+ * Every byte of the compressed form is nonzero, so a compressed value is still a valid C string
+ * and travels through the store, the messages, and the wire exactly like an uncompressed one. The
+ * numbers in it are written as bijective base-127 varints, whose digits are 1 through 127, with
+ * the high bit marking that more digits follow. The layout is
+ *
+ *     CODEC_MARKER, raw length, then sequences of
+ *     literal count, literals, [match length - CODEC_MIN_MATCH, match offset]
+ *
+ * where the last sequence has no match. Literals are copied from the input, which has no zeros.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Codec : public Object {
+public:
+    /** Is the given value compressed? */
+    static bool is_compressed(const char* v) { return v[0] == CODEC_MARKER; }
+
+    /** Returns the most bytes that compressing n bytes can take, including the terminator. */
+    static size_t bound(size_t n) { return n + 32; }
+
+    /**
+     * Returns the compressed form of the given n-byte value, which the caller owns, or nullptr if
+     * compressing it would not make it smaller. Values that start with CODEC_MARKER are always
+     * compressed so that they cannot be mistaken for compressed ones.
+     */
+    static char* compress(const char* src, size_t n) {
+        bool must = n > 0 && src[0] == CODEC_MARKER;
+        if (!must && n < CODEC_MIN_SIZE) return nullptr;
+        char* dst = new char[bound(n)];
+        char* out = dst;
+        *out++ = CODEC_MARKER;
+        out = put_num_(out, n);
+        int32_t* table = new int32_t[1 << CODEC_HASH_BITS];
+        memset(table, -1, sizeof(int32_t) << CODEC_HASH_BITS);
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + CODEC_MIN_MATCH <= n) {
+            uint32_t h = hash_(src + i);
+            int32_t cand = table[h];
+            table[h] = (int32_t)i;
+            if (cand < 0 || i - cand > CODEC_MAX_OFFSET ||
+                memcmp(src + cand, src + i, CODEC_MIN_MATCH) != 0) {
+                i++;
+                continue;
+            }
+            size_t len = CODEC_MIN_MATCH;
+            while (i + len < n && src[cand + len] == src[i + len]) len++;
+            // Only take matches that are shorter encoded than as literals, so that compressing
+            // never makes a value more than a few bytes longer
+            if (num_size_(i - anchor) + num_size_(len - CODEC_MIN_MATCH) + num_size_(i - cand)
+                >= len) {
+                i++;
+                continue;
+            }
+            out = put_literals_(out, src + anchor, i - anchor);
+            out = put_num_(out, len - CODEC_MIN_MATCH);
+            out = put_num_(out, i - cand);
+            i += len;
+            anchor = i;
+            // Remember a position near the end of the match so that the next one can chain on it
+            if (i >= 2 && i + CODEC_MIN_MATCH <= n + 2) table[hash_(src + i - 2)] = i - 2;
+        }
+        out = put_literals_(out, src + anchor, n - anchor);
+        *out = '\0';
+        delete[] table;
+        if (!must && (size_t)(out - dst) >= n) {
+            delete[] dst;
+            return nullptr;
+        }
+        return dst;
+    }
+
+    /**
+     * Returns the original value that the given compressed value was made from, which the caller
+     * owns.
+     */
+    static char* decompress(const char* src) {
+        Sys s;
+        s.exit_if_not(is_compressed(src), "Value is not compressed");
+        const char* in = src + 1;
+        size_t n = get_num_(in);
+        char* dst = new char[n + 1];
+        size_t got = 0;
+        for (;;) {
+            size_t lits = get_num_(in);
+            s.exit_if_not(got + lits <= n, "Corrupt compressed value");
+            memcpy(dst + got, in, lits);
+            in += lits;
+            got += lits;
+            if (got == n) break;
+            size_t len = get_num_(in) + CODEC_MIN_MATCH;
+            size_t off = get_num_(in);
+            s.exit_if_not(off > 0 && off <= got && got + len <= n, "Corrupt compressed value");
+            // A match that overlaps what it is copying repeats it, so it is copied byte by byte
+            char* from = dst + got - off;
+            if (off >= len) memcpy(dst + got, from, len);
+            else for (size_t j = 0; j < len; j++) dst[got + j] = from[j];
+            got += len;
+        }
+        dst[n] = '\0';
+        return dst;
+    }
+
+    /** Returns the hash of the CODEC_MIN_MATCH bytes at the given position. */
+    static uint32_t hash_(const char* p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return (v * 2654435761u) >> (32 - CODEC_HASH_BITS);
+    }
+
+    /** Writes the given number as a bijective base-127 varint and returns the end of it. */
+    static char* put_num_(char* out, size_t v) {
+        size_t m = v + 1;
+        while (m > 0) {
+            size_t d = (m - 1) % 127 + 1;
+            m = (m - d) / 127;
+            *out++ = (char)(d | (m > 0 ? 0x80 : 0));
+        }
+        return out;
+    }
+
+    /** Returns the number of bytes that put_num_() writes for the given number. */
+    static size_t num_size_(size_t v) {
+        size_t bytes = 0;
+        for (size_t m = v + 1; m > 0; bytes++) m = (m - ((m - 1) % 127 + 1)) / 127;
+        return bytes;
+    }
+
+    /** Reads a number written by put_num_() and moves past it. */
+    static size_t get_num_(const char*& in) {
+        size_t m = 0;
+        size_t scale = 1;
+        for (;;) {
+            unsigned char b = *in++;
+            Sys s;
+            s.exit_if_not(b != 0, "Corrupt compressed value");
+            m += (b & 0x7f) * scale;
+            if (!(b & 0x80)) break;
+            scale *= 127;
+        }
+        return m - 1;
+    }
+
+    /** Writes the given literals preceded by their count and returns the end of them. */
+    static char* put_literals_(char* out, const char* lits, size_t n) {
+        out = put_num_(out, n);
+        memcpy(out, lits, n);
+        return out + n;
+    }
+};
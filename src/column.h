@@ -127,6 +127,9 @@ public:
     /** Returns the index of the node on which the field at idx is stored. */
     size_t get_node(size_t idx) { return fields_->get_node(idx); }
 
+    /** Returns the index of the node that scans the field at idx in a local_map(). */
+    size_t get_scan_node(size_t idx) { return fields_->get_scan_node(idx); }
+
     /** Returns the number of fields in this Column. */
     size_t size() { return fields_->size(); }
 
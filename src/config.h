@@ -0,0 +1,139 @@
+//lang::CwC
+
+#pragma once
+
+#include "object.h"
+
+// The default number of threads that handle the Puts, Gets, and WaitAndGets sent by other nodes
+#define DEFAULT_HANDLER_THREADS 8
+// The default number of chunks that a DistributedVector moves to or from one node per round trip
+#define DEFAULT_BATCH_CHUNKS 32
+// The default number of async puts that may be waiting on an Ack from one node at a time
+#define DEFAULT_PUT_WINDOW 8
+// The default number of independently locked shards that a KVStore's map is split into
+#define DEFAULT_MAP_SHARDS 16
+// Whether nodes on the same host talk over Unix sockets instead of TCP by default
+#define DEFAULT_LOCAL_TRANSPORT true
+// Whether values are compressed before they are stored and sent by default
+#define DEFAULT_COMPRESS false
+// The default size that a node's log grows to before its map is snapshotted
+#define DEFAULT_SNAPSHOT_BYTES (64 * 1024 * 1024)
+// The default directory that values are spilled to when a node is over its memory budget
+#define DEFAULT_SPILL_DIR "/tmp"
+// The default number of nodes that each chunk of a DataFrame is stored on
+#define DEFAULT_REPLICATION 1
+// The default number of points that each node owns on the consistent hashing ring
+#define DEFAULT_RING_VNODES 64
+// The default number of leading chunks of a column that Sized placement keeps on one node
+#define DEFAULT_SMALL_CHUNKS 4
+// The default size of the cache of chunks that a node fetched from other nodes
+#define DEFAULT_CHUNK_CACHE_BYTES (64 * 1024 * 1024)
+// The default number of chunks that a sequential scan of a column asks other nodes for ahead
+#define DEFAULT_READ_AHEAD_CHUNKS 8
+// The default number of data requests that a node may have outstanding on each other node
+#define DEFAULT_FLOW_MESSAGES 64
+// The default number of bytes that a node's outstanding requests to each other node may carry
+#define DEFAULT_FLOW_BYTES (64 * 1024 * 1024)
+// The default size of the largest meta or value that a message may carry
+#define DEFAULT_MAX_FRAME_BYTES (256 * 1024 * 1024)
+
+/** How the chunks of a new DataFrame are assigned to nodes, see src/placement.h */
+enum class Placement {
+    // Chunk i goes to node i % N
+    Modulo,
+    // Chunks are consistently hashed onto a ring of virtual nodes
+    Ring,
+    // Small columns stay on the node that built them, and the rest of a large one is hashed
+    Sized
+};
+
+/**
+ * The tunable settings of one node's KVStore. Every field starts out at its default, so callers
+ * only need to set the ones they care about before handing the config to the store.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class KVConfig : public Object {
+public:
+    // The number of worker threads that handle requests from other nodes
+    size_t handler_threads_;
+    // The number of chunks that a DistributedVector batches into one MultiPut or MultiGet
+    size_t batch_chunks_;
+    // The number of async puts that may be waiting on an Ack from one node at a time
+    size_t put_window_;
+    // The number of independently locked shards that the KVStore's map is split into
+    size_t map_shards_;
+    // Do nodes on the same host talk over Unix sockets rather than loopback TCP?
+    bool local_transport_;
+    // The path of the file listing the address of every node, or nullptr to learn them from the
+    // server's Directory instead. Not owned
+    const char* members_file_;
+    // The "host:port" this node listens on when there is no membership file, or nullptr for
+    // 127.0.0.(idx + 1):8080. Not owned
+    const char* address_;
+    // The "host:port" of the server when there is no membership file, or nullptr for
+    // 127.0.0.1:8080. Not owned
+    const char* server_address_;
+    // Are values compressed before they are stored and sent?
+    bool compress_;
+    // The directory where this node logs its puts and snapshots its map, so that a restart gets
+    // its data back, or nullptr to keep the data in memory only. Not owned
+    const char* data_dir_;
+    // The size that the log grows to before the map is snapshotted and the log started over
+    size_t snapshot_bytes_;
+    // The most bytes of values that this node keeps on the heap before it spills the ones used
+    // least lately to disk, or 0 for no limit
+    size_t memory_budget_;
+    // The directory that values are spilled to. Not owned
+    const char* spill_dir_;
+    // The number of nodes that each chunk of a new DataFrame is stored on: its home and the
+    // nodes after it. Reads use a copy on the reading node when there is one
+    size_t replication_;
+    // How the chunks of a new DataFrame are spread over the nodes
+    Placement placement_;
+    // The number of points that each node owns on the ring, for Ring and Sized placement
+    size_t ring_vnodes_;
+    // The number of leading chunks of each column that Sized placement keeps on one node
+    size_t small_chunks_;
+    // The most bytes of serialized chunks fetched from other nodes that this node keeps
+    // deserialized for later reads, or 0 to keep none
+    size_t chunk_cache_bytes_;
+    // The number of chunks after the current one that a sequential scan of a column asks other
+    // nodes for in the background, or 0 to only fetch chunks when they are read
+    size_t read_ahead_chunks_;
+    // The most Puts, Gets, MultiPuts and MultiGets that this node may have waiting on a response
+    // from any one other node, or 0 for no limit
+    size_t flow_messages_;
+    // The most bytes of values that this node's outstanding requests to any one other node may
+    // carry, or 0 for no limit
+    size_t flow_bytes_;
+    // The most bytes that either part of a message, its meta or its values, may have. A larger
+    // one is refused before anything is allocated for it, since it means the stream is corrupt
+    size_t max_frame_bytes_;
+    // Do nodes talk over in-process loopback connections instead of sockets? Every node of the
+    // cluster must then run in this process, as under src/cluster.h
+    bool loopback_;
+    // The delay that the loopback transport adds to every message, in microseconds
+    size_t net_latency_us_;
+    // The most extra delay that the loopback transport adds to a message, in microseconds
+    size_t net_jitter_us_;
+    // The bytes per second that each loopback connection can carry, or 0 for no limit
+    size_t net_bytes_per_sec_;
+    // The seed that the loopback transport draws each message's extra delay from
+    size_t net_seed_;
+
+    /** Constructor that uses the default for every setting */
+    KVConfig() : handler_threads_(DEFAULT_HANDLER_THREADS), batch_chunks_(DEFAULT_BATCH_CHUNKS),
+        put_window_(DEFAULT_PUT_WINDOW), map_shards_(DEFAULT_MAP_SHARDS),
+        local_transport_(DEFAULT_LOCAL_TRANSPORT), members_file_(nullptr), address_(nullptr),
+        server_address_(nullptr), compress_(DEFAULT_COMPRESS), data_dir_(nullptr),
+        snapshot_bytes_(DEFAULT_SNAPSHOT_BYTES), memory_budget_(0), spill_dir_(DEFAULT_SPILL_DIR),
+        replication_(DEFAULT_REPLICATION), placement_(Placement::Modulo),
+        ring_vnodes_(DEFAULT_RING_VNODES), small_chunks_(DEFAULT_SMALL_CHUNKS),
+        chunk_cache_bytes_(DEFAULT_CHUNK_CACHE_BYTES),
+        read_ahead_chunks_(DEFAULT_READ_AHEAD_CHUNKS), flow_messages_(DEFAULT_FLOW_MESSAGES),
+        flow_bytes_(DEFAULT_FLOW_BYTES), max_frame_bytes_(DEFAULT_MAX_FRAME_BYTES),
+        loopback_(false), net_latency_us_(0), net_jitter_us_(0), net_bytes_per_sec_(0),
+        net_seed_(0) { }
+};
@@ -145,6 +145,12 @@ public:
         Column* column = dynamic_cast<Column*>(columns_.get(0));
         return column->get_node(row);
     }
+
+    /** Returns the index of the node that visits the given row in local_map(). */
+    size_t get_scan_node(size_t row) {
+        Column* column = dynamic_cast<Column*>(columns_.get(0));
+        return column->get_scan_node(row);
+    }
     
     /** Set the fields of the given row object with values from the columns at
          * the given offset.  If the row is not form the same schema as the
@@ -201,6 +207,8 @@ public:
             // Finalize the columns
             if (last_row) col->lock();
         }
+        // Wait for the columns' chunks to land
+        if (last_row) kv_->flush();
         length_++;
     }
     
@@ -220,11 +228,12 @@ public:
         }
     }
 
-    /** Visit only the rows that are stored on the current node */
+    /** Visit only the rows that this node is assigned to scan, all of which are stored on it.
+     *  Across all of the nodes, every row is visited once. */
     void local_map(Rower& r) {
         Row row(schema_);
         for (int i = 0; i < length_; i++) {
-            if (get_node(i) == kv_->this_node()) {
+            if (get_scan_node(i) == kv_->this_node()) {
                 row.set_idx(i);
                 fill_row(i, row);
                 r.accept(row);
@@ -247,10 +256,11 @@ public:
         return df;
     }
 
-    /** Locks all of this DataFrame's columns. */
+    /** Locks all of this DataFrame's columns and waits for their chunks to land in the store. */
     void lock_columns() {
         for (int j = 0; j < ncols(); j++)
             dynamic_cast<Column*>(columns_.get(j))->lock();
+        kv_->flush();
     }
     
     /** Print the dataframe in SoR format to standard output. */
@@ -394,12 +404,13 @@ Chunk* Deserializer::deserialize_chunk() {
 DistributedVector* Deserializer::deserialize_dist_vector(KVStore* kv) {
     StrBuff buff;
     size_t size = deserialize_size_t();
+    size_t replicas = deserialize_size_t();
     assert(step() == '[');
     Vector* keys = new Vector();
     while (current() != ']')
         keys->append(deserialize_key());
     assert(step() == ']');
-    return new DistributedVector(kv, size, keys);
+    return new DistributedVector(kv, size, keys, replicas);
 }
 
 /** Builds and returns a Column from the bytestream. */
@@ -20,17 +20,29 @@ public:
     const char* stream_;
     int i_; // current location in the stream
     char* x_;
+    // The value of the Put or Reply in the stream when it was received apart from the rest of the
+    // message, or nullptr if the value follows the message's fields in the stream. Owned until a
+    // Put or Reply takes it.
+    char* blob_;
     
 
-    Deserializer(const char* stream) {
+    Deserializer(const char* stream) : Deserializer(stream, nullptr) { }
+
+    /**
+     * Constructor for a message whose value was received separately from its fields. The
+     * Deserializer takes ownership of the value, which must be null-terminated.
+     */
+    Deserializer(const char* stream, char* blob) {
         stream_ = stream;
         i_ = 0;
         x_ = new char[sizeof(char) + 1];
         x_[1] = '\0';
+        blob_ = blob;
     }
 
     ~Deserializer() {
         delete[] x_;
+        delete[] blob_;
     }
 
     /* Returns the current character in the stream. */
@@ -129,16 +141,29 @@ public:
     Message* deserialize_message() {
         MsgKind kind = (MsgKind)deserialize_size_t();
         switch (kind) {
-            case MsgKind::Ack:          return new Ack();
+            case MsgKind::Ack:          return deserialize_ack();
             case MsgKind::Register:     return deserialize_register();
             case MsgKind::Directory:    return deserialize_directory();
             case MsgKind::Reply:        return deserialize_reply();
             case MsgKind::Put:          return deserialize_put();
             case MsgKind::Get:          return deserialize_get();
             case MsgKind::WaitAndGet:   return deserialize_wait_get();
+            case MsgKind::MultiPut:     return deserialize_multi_put();
+            case MsgKind::MultiGet:     return deserialize_multi_get();
+            case MsgKind::MultiReply:   return deserialize_multi_reply();
+            case MsgKind::Barrier:      return deserialize_barrier();
+            case MsgKind::Stats:        return deserialize_stats();
+            case MsgKind::Collective:   return deserialize_collective();
         }
     }
 
+    /* Builds and returns an Ack from the bytestream. */
+    Ack* deserialize_ack() {
+        size_t id = deserialize_size_t();
+        assert(step() == '\n');
+        return new Ack(id);
+    }
+
     /* Builds and returns a Directory from the bytestream. */
     Directory* deserialize_directory() {
         Vector* addresses = deserialize_string_vector();
@@ -157,42 +182,134 @@ public:
 
     /* Builds and returns a Put message from the bytestream. */
     Put* deserialize_put() {
+        size_t id = deserialize_size_t();
         Key* k = deserialize_key();
-        // Extract the blob of serialized data
-        StrBuff buff;
-        while (current() != '\n') {
-            *x_ = step();
-            buff.c(x_);
-        }
         assert(step() == '\n');
-        return new Put(k, buff.c_str());
+        return new Put(k, take_blob_(), id);
     }
 
     /* Builds and returns a Get message from the bytestream. */
     Get* deserialize_get() {
+        size_t id = deserialize_size_t();
         Key* k = deserialize_key();
         assert(step() == '\n');
-        return new Get(k);
+        return new Get(k, id);
     }
 
     /* Builds and returns a WaitAndGet message from the bytestream. */
     WaitAndGet* deserialize_wait_get() {
+        size_t id = deserialize_size_t();
         Key* k = deserialize_key();
         assert(step() == '\n');
-        return new WaitAndGet(k);
+        return new WaitAndGet(k, id);
     }
 
     /* Builds and returns a Reply message from the bytestream. */
     Reply* deserialize_reply() {
         MsgKind req = (MsgKind)deserialize_size_t();
-        // Extract the serialized data
-        StrBuff buff;
-        while (current() != '\n') {
-            *x_ = step();
-            buff.c(x_);
-        }
+        size_t id = deserialize_size_t();
+        assert(step() == '\n');
+        return new Reply(take_blob_(), req, id);
+    }
+
+    /* Builds and returns a MultiPut message from the bytestream. */
+    MultiPut* deserialize_multi_put() {
+        size_t id = deserialize_size_t();
+        size_t n = deserialize_size_t();
+        Key** keys = new Key*[n];
+        for (size_t i = 0; i < n; i++) keys[i] = deserialize_key();
+        Blob* values = deserialize_values_(n);
+        return new MultiPut(keys, values, n, id);
+    }
+
+    /* Builds and returns a MultiGet message from the bytestream. */
+    MultiGet* deserialize_multi_get() {
+        size_t id = deserialize_size_t();
+        size_t n = deserialize_size_t();
+        Key** keys = new Key*[n];
+        for (size_t i = 0; i < n; i++) keys[i] = deserialize_key();
+        assert(step() == '\n');
+        return new MultiGet(keys, n, id);
+    }
+
+    /* Builds and returns a MultiReply message from the bytestream. */
+    MultiReply* deserialize_multi_reply() {
+        size_t id = deserialize_size_t();
+        size_t n = deserialize_size_t();
+        Blob* values = deserialize_values_(n);
+        return new MultiReply(values, n, id);
+    }
+
+    /* Builds and returns a Barrier message from the bytestream. */
+    Barrier* deserialize_barrier() {
+        size_t epoch = deserialize_size_t();
+        size_t sender = deserialize_size_t();
+        assert(step() == '\n');
+        return new Barrier(epoch, sender);
+    }
+
+    /* Builds and returns a Stats request from the bytestream. */
+    Stats* deserialize_stats() {
+        size_t id = deserialize_size_t();
+        assert(step() == '\n');
+        return new Stats(id);
+    }
+
+    /* Builds and returns a Collective message from the bytestream. */
+    Collective* deserialize_collective() {
+        size_t epoch = deserialize_size_t();
+        size_t sender = deserialize_size_t();
         assert(step() == '\n');
-        return new Reply(buff.c_str(), req);
+        return new Collective(epoch, sender, take_blob_());
+    }
+
+    /**
+     * Reads the lengths of the given number of values that end a MultiPut's or MultiReply's
+     * fields, and returns a handle to each of the values that follow them, which the caller owns.
+     *
+     * Values received apart from the fields, as the KVStore receives them, each end in their own
+     * terminator, so the handles point into the received buffer and share it, and the last one to
+     * go frees it. Values that follow the fields in the stream are packed together, and are copied
+     * out.
+     */
+    Blob* deserialize_values_(size_t n) {
+        size_t* lens = new size_t[n];
+        for (size_t i = 0; i < n; i++) lens[i] = deserialize_size_t();
+        assert(step() == '\n');
+        bool received = blob_ != nullptr;
+        Blob whole(take_blob_());
+        Blob* values = new Blob[n];
+        size_t off = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (received) {
+                values[i] = Blob(whole.c_str() + off, lens[i], [whole]() { });
+                off += lens[i] + 1;
+            } else {
+                char* v = new char[lens[i] + 1];
+                memcpy(v, whole.c_str() + off, lens[i]);
+                v[lens[i]] = '\0';
+                values[i] = Blob(v);
+                off += lens[i];
+            }
+        }
+        delete[] lens;
+        return values;
+    }
+
+    /**
+     * Returns the value of the Put, Reply, or Collective being deserialized, which the caller
+     * then owns. It is handed over as is when it was received apart from the message's fields,
+     * and otherwise it is the rest of the stream.
+     */
+    char* take_blob_() {
+        char* blob = blob_;
+        blob_ = nullptr;
+        if (blob != nullptr) return blob;
+        size_t len = strlen(stream_ + i_);
+        blob = new char[len + 1];
+        memcpy(blob, stream_ + i_, len + 1);
+        i_ += len;
+        return blob;
     }
 
     /* Builds and returns a String from the bytestream. */
@@ -5,6 +5,9 @@
 #include "datatype.h"
 #include "kvstore.h"
 
+// Stands for no chunk at all, such as the last one read before the first read
+#define NO_CHUNK ((size_t)-1)
+
 /**
  * This class represents a unit of the DistributedVector, i.e. a fixed-size array of fields.
  * 
@@ -72,10 +75,53 @@ public:
     }
 };
 
+/**
+ * A MultiGet that a DistributedVector sent ahead of a sequential scan and has not collected the
+ * chunks of yet. Not exposed; only DistributedVector creates these.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ReadAhead_ : public Object {
+public:
+    // The ID of the MultiGet
+    size_t id_;
+    // The keys that were asked for, owned
+    Key** keys_;
+    // The index of the chunk at each key
+    size_t* idxs_;
+    // The number of keys
+    size_t n_;
+
+    /** Constructor, takes ownership of the given keys and indices */
+    ReadAhead_(size_t id, Key** keys, size_t* idxs, size_t n) : id_(id), keys_(keys),
+        idxs_(idxs), n_(n) { }
+
+    /** Destructor */
+    ~ReadAhead_() {
+        for (size_t i = 0; i < n_; i++) delete keys_[i];
+        delete[] keys_;
+        delete[] idxs_;
+    }
+
+    /** Is the chunk with the given index one of the ones asked for? */
+    bool holds(size_t chunk) {
+        for (size_t i = 0; i < n_; i++) {
+            if (idxs_[i] == chunk) return true;
+        }
+        return false;
+    }
+};
+
 /**
  * A vector of DataFrame fields. The fields are split into chunks of a fixed size and each chunk
  * is serialized and stored in the KVStore. So this is essentially just a vector of keys that point
  * to the chunks.
+ *
+ * Chunk i lives on the node that the KVStore's PlacementPolicy picks, its home (i % N by
+ * default), and with a replication factor of r also on the r - 1
+ * nodes after it. Every copy is stored under the same key string, so a copy is read by asking
+ * the node that holds it for that string. Reads prefer a copy on this node.
  * 
  * @author Spencer LaChance <lachance.s@northeastern.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
@@ -96,46 +142,294 @@ public:
     KeyBuff* kbuf_;
     // Have all fields been added to this DVector?
     bool is_locked_;
+    // Keys of the full chunks that have not been put into the KVStore yet, external
+    Key** batch_keys_;
+    // The serialized chunks that have not been put into the KVStore yet, owned
+    const char** batch_values_;
+    // The number of chunks waiting to be put, counting each copy of a chunk
+    size_t batch_size_;
+    // The number of nodes that each chunk is stored on
+    size_t replicas_;
+    // Chunks fetched from the KVStore ahead of being read, indexed by chunk index, or nullptr
+    // before the first read. The chunks from other nodes are shared with the KVStore's
+    // ChunkCache. Only the ones near the last read are kept (see window_()). Owned.
+    std::shared_ptr<Chunk>* fetched_;
+    // Every chunk in fetched_ has an index in [held_start_, held_end_)
+    size_t held_start_;
+    size_t held_end_;
+    // The index of the chunk that was read last, so that a sequential scan can be told apart
+    size_t last_read_;
+    // The MultiGets sent ahead of a sequential scan that have not been collected yet
+    std::vector<ReadAhead_*> ahead_;
 
     /** Initialize an empty DistributedVector. The given Key is that of the column that owns this
      *  DVector, the keys for each chunk are built off of it. */
     DistributedVector(KVStore* kv, Key* k) : 
         size_(0), current_(new Chunk(0)), keys_(new Vector()), kv_(kv), k_(k), 
-        kbuf_(new KeyBuff(k_)), is_locked_(false) { }
+        kbuf_(new KeyBuff(k_)), is_locked_(false), batch_size_(0), fetched_(nullptr),
+        held_start_(0), held_end_(0), last_read_(NO_CHUNK) {
+        replicas_ = std::max((size_t)1, std::min(kv_->cfg_.replication_, kv_->num_nodes()));
+        batch_keys_ = new Key*[kv_->cfg_.batch_chunks_ * replicas_];
+        batch_values_ = new const char*[kv_->cfg_.batch_chunks_ * replicas_];
+    }
 
-    /** Initialize a DistributedVector containing the given keys. The given Key is that of the 
-     *  column that owns this DVector, the keys for each chunk are built off of it. */
-    DistributedVector(KVStore* kv, size_t size, Vector* keys) : 
+    /** Initialize a DistributedVector containing the given keys, whose chunks are each stored
+     *  on the given number of nodes. */
+    DistributedVector(KVStore* kv, size_t size, Vector* keys, size_t replicas) : 
         size_(size), current_(nullptr), keys_(keys), kv_(kv), k_(nullptr), kbuf_(nullptr),
-        is_locked_(true) { }
+        is_locked_(true), batch_size_(0), replicas_(replicas), fetched_(nullptr),
+        held_start_(0), held_end_(0), last_read_(NO_CHUNK) {
+        batch_keys_ = new Key*[kv_->cfg_.batch_chunks_ * replicas_];
+        batch_values_ = new const char*[kv_->cfg_.batch_chunks_ * replicas_];
+    }
 
     /** Destructor */
     ~DistributedVector() { 
         if (kbuf_ != nullptr) delete kbuf_;
         if (k_ != nullptr) delete k_;
         if (current_ != nullptr) delete current_;
+        drop_read_ahead_();
+        forget_fetched_(0, 0);
+        delete[] fetched_;
+        delete[] batch_keys_;
+        delete[] batch_values_;
         delete keys_;
     }
 
-    /** Serializes the current chunk and puts it into the KVStore */
+    /** Serializes the current chunk and queues it, and its copies, to be put into the KVStore */
     void store_chunk_(size_t idx) {
         kbuf_->c("-");
         kbuf_->c(idx);
-        Key* k = kbuf_->get(idx % kv_->num_nodes());
-        kv_->put(*k, current_->serialize());
+        Key* k = kbuf_->get(0);
+        k->idx_ = kv_->placement()->home(k->get_keystring()->c_str(), idx, kv_->idx_);
+        // The chunk may be replacing one that this node cached, if the DVector was unlocked
+        kv_->chunk_cache()->erase(k->get_keystring()->c_str());
         keys_->set(k, idx);
+        const char* serial = current_->serialize();
+        // The home copy comes first, followed by the others, which the batch owns
+        for (size_t j = 0; j < replicas_; j++) {
+            batch_keys_[batch_size_] = j == 0 ? k : key_on_(idx, replica_node_(idx, j));
+            batch_values_[batch_size_] = j == 0 ? serial : duplicate(serial);
+            batch_size_++;
+        }
         delete current_;
         current_ = nullptr;
+        if (batch_size_ == kv_->cfg_.batch_chunks_ * replicas_) flush_chunks_();
+    }
+
+    /**
+     * Sends every queued chunk to the KVStore, with one message per node. The chunks are put
+     * asynchronously so that the next batch can be serialized while this one is in transit;
+     * KVStore::flush() waits for them to land.
+     */
+    void flush_chunks_() {
+        if (batch_size_ == 0) return;
+        kv_->multi_put_async(batch_keys_, batch_values_, batch_size_);
+        for (size_t i = 0; i < batch_size_; i++) {
+            if (i % replicas_ != 0) delete batch_keys_[i];
+        }
+        batch_size_ = 0;
+    }
+
+    /** Returns the node that holds the given copy of the chunk with the given index. */
+    size_t replica_node_(size_t n, size_t copy) {
+        size_t home = dynamic_cast<Key*>(keys_->get(n))->get_home_node();
+        return (home + copy) % kv_->num_nodes();
+    }
+
+    /** Returns a new key for the copy of the chunk with the given index on the given node. */
+    Key* key_on_(size_t n, size_t node) {
+        Key* k = dynamic_cast<Key*>(keys_->get(n));
+        return new Key(k->get_keystring()->c_str(), node);
+    }
+
+    /** Returns the node to read the chunk with the given index from: this one if it has a copy,
+     *  otherwise the chunk's home. */
+    size_t read_node_(size_t n) {
+        size_t home = dynamic_cast<Key*>(keys_->get(n))->get_home_node();
+        size_t nodes = kv_->num_nodes();
+        size_t ahead = (kv_->this_node() + nodes - home) % nodes;
+        return ahead < replicas_ ? kv_->this_node() : home;
+    }
+
+    /**
+     * Returns the chunk with the given index, fetching it from the KVStore if it is not already
+     * here. Once the reads move on to the next chunk in order, the chunks up to
+     * KVConfig::read_ahead_chunks_ after it that live on other nodes are asked for in the
+     * background, so that they arrive while this one is being read. Moving to another chunk lets
+     * go of the fetched chunks outside of the window that starts at it.
+     */
+    Chunk* fetched_chunk_(size_t n) {
+        if (fetched_ == nullptr) fetched_ = new std::shared_ptr<Chunk>[keys_->size()];
+        if (!fetched_[n] && !cached_(n)) {
+            ReadAhead_* r = read_ahead_of_(n);
+            if (r != nullptr) collect_(r);
+            else fetch_(n);
+        }
+        if (n != last_read_) {
+            forget_fetched_(n, n + window_());
+            if (n == last_read_ + 1) read_ahead_(n);
+            last_read_ = n;
+        }
+        return fetched_[n].get();
+    }
+
+    /**
+     * Returns the number of chunks, starting at the one read last, that are kept once fetched:
+     * enough for a fetch of a batch from every node, or for the read-ahead, whichever is more.
+     */
+    size_t window_() {
+        return std::max(kv_->cfg_.batch_chunks_ * kv_->num_nodes(),
+            kv_->cfg_.read_ahead_chunks_ + 1);
+    }
+
+    /** Keeps the given chunk as the one with the given index. */
+    void keep_(size_t n, std::shared_ptr<Chunk> c) {
+        fetched_[n] = c;
+        if (held_start_ == held_end_) held_start_ = n;
+        held_start_ = std::min(held_start_, n);
+        held_end_ = std::max(held_end_, n + 1);
+    }
+
+    /**
+     * Fetches the chunk with the given index. A fetch also brings in the chunks after it that
+     * live on the same node, up to a batch's worth, in the same round trip, so a scan makes one
+     * round trip per batch per node rather than one per chunk. Chunks outside of the window that
+     * the fetch covers are dropped. Chunks from other nodes come from the node's ChunkCache when
+     * they are in it, and go into it when they are not.
+     */
+    void fetch_(size_t n) {
+        size_t nchunks = keys_->size();
+        // Make sure that every chunk this node put has landed
+        kv_->flush();
+        // Every node can hold up to a batch of the chunks that come next
+        size_t batch = kv_->cfg_.batch_chunks_;
+        size_t end = std::min(nchunks, n + batch * kv_->num_nodes());
+        forget_fetched_(n, end);
+        size_t home = read_node_(n);
+        bool remote = home != kv_->this_node();
+        Key** keys = new Key*[batch];
+        size_t* idxs = new size_t[batch];
+        size_t count = 0;
+        for (size_t i = n; i < end && count < batch; i++) {
+            if (fetched_[i] || read_node_(i) != home || read_ahead_of_(i) != nullptr) continue;
+            if (i != n && remote && cached_(i)) continue;
+            keys[count] = key_on_(i, home);
+            idxs[count] = i;
+            count++;
+        }
+        Blob* serial_chunks = kv_->multi_get(keys, count);
+        for (size_t i = 0; i < count; i++) {
+            Deserializer ds(serial_chunks[i].c_str());
+            keep_(idxs[i], std::shared_ptr<Chunk>(ds.deserialize_chunk()));
+            // The serialized size stands in for the deserialized one
+            if (remote) kv_->chunk_cache()->put(keys[i]->get_keystring()->c_str(),
+                fetched_[idxs[i]], serial_chunks[i].size());
+            delete keys[i];
+        }
+        delete[] serial_chunks;
+        delete[] keys;
+        delete[] idxs;
+    }
+
+    /**
+     * Asks the other nodes for the chunks after the one with the given index, up to the
+     * read-ahead depth, that are not here, cached, or already asked for. Each node gets one
+     * MultiGet for up to a batch of them, and none of them are waited for.
+     */
+    void read_ahead_(size_t n) {
+        size_t end = std::min(keys_->size(), n + 1 + kv_->cfg_.read_ahead_chunks_);
+        if (end <= n + 1) return;
+        kv_->flush();
+        size_t batch = kv_->cfg_.batch_chunks_;
+        for (size_t node = 0; node < kv_->num_nodes(); node++) {
+            if (node == kv_->this_node()) continue;
+            Key** keys = new Key*[batch];
+            size_t* idxs = new size_t[batch];
+            size_t count = 0;
+            for (size_t i = n + 1; i < end && count < batch; i++) {
+                if (fetched_[i] || read_node_(i) != node || read_ahead_of_(i) != nullptr) continue;
+                if (cached_(i)) continue;
+                keys[count] = key_on_(i, node);
+                idxs[count] = i;
+                count++;
+            }
+            if (count == 0) {
+                delete[] keys;
+                delete[] idxs;
+                continue;
+            }
+            ahead_.push_back(new ReadAhead_(kv_->multi_get_async(keys, count), keys, idxs, count));
+        }
+    }
+
+    /** Returns the read-ahead that asked for the chunk with the given index, or nullptr. */
+    ReadAhead_* read_ahead_of_(size_t n) {
+        for (size_t i = 0; i < ahead_.size(); i++) {
+            if (ahead_[i]->holds(n)) return ahead_[i];
+        }
+        return nullptr;
+    }
+
+    /** Waits for the chunks of the given read-ahead, keeps and caches them, and deletes it. */
+    void collect_(ReadAhead_* r) {
+        ahead_.erase(std::find(ahead_.begin(), ahead_.end(), r));
+        Blob* serial_chunks = kv_->await_multi_get(r->id_, r->n_);
+        for (size_t i = 0; i < r->n_; i++) {
+            Deserializer ds(serial_chunks[i].c_str());
+            keep_(r->idxs_[i], std::shared_ptr<Chunk>(ds.deserialize_chunk()));
+            kv_->chunk_cache()->put(r->keys_[i]->get_keystring()->c_str(),
+                fetched_[r->idxs_[i]], serial_chunks[i].size());
+        }
+        delete[] serial_chunks;
+        delete r;
+    }
+
+    /**
+     * Gives up on every outstanding read-ahead without waiting for it. The KVStore throws the
+     * chunks away when they arrive.
+     */
+    void drop_read_ahead_() {
+        for (size_t i = 0; i < ahead_.size(); i++) {
+            kv_->cancel_multi_get(ahead_[i]->id_);
+            delete ahead_[i];
+        }
+        ahead_.clear();
+        last_read_ = NO_CHUNK;
+    }
+
+    /**
+     * Looks the chunk with the given index up in the node's ChunkCache if it is read from
+     * another node, and keeps it if it is there. Returns whether it was.
+     */
+    bool cached_(size_t n) {
+        if (read_node_(n) == kv_->this_node()) return false;
+        Key* k = dynamic_cast<Key*>(keys_->get(n));
+        std::shared_ptr<Chunk> c = std::static_pointer_cast<Chunk>(
+            kv_->chunk_cache()->get(k->get_keystring()->c_str()));
+        if (c) keep_(n, c);
+        return (bool)c;
+    }
+
+    /** Lets go of every fetched chunk whose index is outside of [start, end) */
+    void forget_fetched_(size_t start, size_t end) {
+        if (fetched_ == nullptr) return;
+        for (size_t i = held_start_; i < held_end_; i++) {
+            if (i < start || i >= end) fetched_[i].reset();
+        }
+        held_start_ = std::max(held_start_, start);
+        held_end_ = std::min(held_end_, end);
+        if (held_start_ >= held_end_) held_start_ = held_end_ = 0;
     }
 
     /** Retrieves the nth chunk from the KVStore and deserialize it. */
     void retrieve_chunk_(size_t n) {
         Key* k = dynamic_cast<Key*>(keys_->get(n));
-        const char* serial_chunk = kv_->get(*k);
-        Deserializer ds(serial_chunk);
+        // The chunk's bytes are shared with the map when it lives on this node
+        Blob serial_chunk = kv_->get(*k);
+        Deserializer ds(serial_chunk.c_str());
         // The chunk is cached because it will likely be needed for the next get()
         current_ = ds.deserialize_chunk();
-        delete[] serial_chunk;
     }
     
     // Appends val to the end of the vector.
@@ -160,13 +454,8 @@ public:
         size_t chunk_idx = index / CHUNK_SIZE;
         // The index of the field in the chunk
         size_t field_idx = index % CHUNK_SIZE;
-        if (current_ == nullptr || current_->idx() != chunk_idx) {
-            if (current_ != nullptr) delete current_;
-            // Retrieve the chunk from the KVStore
-            retrieve_chunk_(chunk_idx);
-        }
         // Retrieve the field from the chunk and clone it so we can delete the chunk later.
-        DataType* res = current_->get(field_idx)->clone();
+        DataType* res = fetched_chunk_(chunk_idx)->get(field_idx)->clone();
         return res;
     }
 
@@ -175,6 +464,20 @@ public:
         Key* k = dynamic_cast<Key*>(keys_->get(idx / CHUNK_SIZE));
         return k->get_home_node();
     }
+
+    /**
+     * Returns the node that scans the field at idx in a local_map(). Every node that holds a
+     * copy of the field's chunk could, so the copies take turns: the first N chunks are scanned
+     * on their homes, the next N on the node after, and so on, which keeps each scan on local
+     * data and, with modulo placement, gives every node the same share of the chunks.
+     */
+    size_t get_scan_node(size_t idx) {
+        size_t n = idx / CHUNK_SIZE;
+        return replica_node_(n, (n / kv_->num_nodes()) % replicas_);
+    }
+
+    /** Returns the number of nodes that each chunk is stored on. */
+    size_t replicas() { return replicas_; }
     
     // Returns the number of fields in this vector. 
     size_t size() {
@@ -186,15 +489,24 @@ public:
         exit_if_not(!is_locked_, "DistVector is already locked");
         // Put the last chunk in the KVStore if it has any fields
         if (current_->size() > 0) store_chunk_(current_->idx());
+        else {
+            delete current_;
+            current_ = nullptr;
+        }
+        flush_chunks_();
         is_locked_ = true;
     }
 
     /** Called when more fields must be added to this locked DVector */
     void unlock() {
         exit_if_not(is_locked_, "DistVector is already unlocked");
-        // Delete the cached chunk if there is one
-        if (current_ != nullptr) delete current_;
-        // Get the last chunk from the KVStore.
+        // Delete the cached chunks, because the last one is about to change
+        drop_read_ahead_();
+        forget_fetched_(0, 0);
+        delete[] fetched_;
+        fetched_ = nullptr;
+        // Get the last chunk from the KVStore, once every chunk this node put has landed
+        kv_->flush();
         size_t last_chunk = keys_->size() - 1;
         retrieve_chunk_(last_chunk);
         is_locked_ = false;
@@ -208,6 +520,10 @@ public:
         const char* serial_size = Serializer::serialize_size_t(size_);
         sbuf.c(serial_size);
         delete[] serial_size;
+        // Serialize the replication factor
+        const char* serial_replicas = Serializer::serialize_size_t(replicas_);
+        sbuf.c(serial_replicas);
+        delete[] serial_replicas;
         // Serialize the keys
         sbuf.c("[");
         for (int i = 0; i < keys_->size(); i++) {
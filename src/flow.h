@@ -0,0 +1,116 @@
+//lang::Cpp
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "object.h"
+
+// The size of a value that a read reserves credits for before any reply has shown the real size
+#define DEFAULT_READ_VALUE_BYTES (64 * 1024)
+
+/**
+ * The credits that one node has for sending requests to one other node. Every request that
+ * moves data takes one message credit and as many byte credits as the data it carries, and gives
+ * them back when its response arrives. Once either window is used up, the next request waits,
+ * so a node can never have more than a window's worth of work queued up on a peer, no matter how
+ * fast it produces it. A request bigger than the whole byte window may go once nothing else is
+ * outstanding, so it cannot wait forever.
+ *
+ * A read does not know how much data its reply will carry, so it takes byte credits for an
+ * estimate: the number of values it asks for times the average size of the values that recent
+ * replies from the same node carried. Every reply moves that average towards what it actually
+ * carried, so reads of large chunks take large credits after the first few replies.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class FlowWindow : public Object {
+public:
+    // The most requests that may be outstanding at once, or 0 for no limit
+    size_t max_msgs_;
+    // The most bytes of data that outstanding requests may carry, or 0 for no limit
+    size_t max_bytes_;
+    // The number of outstanding requests. Guarded by mtx_
+    size_t msgs_;
+    // The bytes of data carried by outstanding requests. Guarded by mtx_
+    size_t bytes_;
+    // Has the node shut down? Once it has, nothing waits. Guarded by mtx_
+    bool closed_;
+    // The lock that guards the window
+    std::mutex mtx_;
+    // Signalled when credits are given back or the window is closed
+    std::condition_variable cv_;
+    // The number of requests that had to wait for credits
+    std::atomic<size_t> stalls_;
+    // The total time that requests spent waiting for credits, in microseconds
+    std::atomic<size_t> stall_us_;
+    // The average size of the values that reads got back, in bytes. Guarded by mtx_
+    size_t read_value_bytes_;
+
+    /** Constructor for a window with no limits */
+    FlowWindow() : max_msgs_(0), max_bytes_(0), msgs_(0), bytes_(0), closed_(false), stalls_(0),
+        stall_us_(0), read_value_bytes_(DEFAULT_READ_VALUE_BYTES) { }
+
+    /** Sets the size of the window. Must be called before the window is used. */
+    void limit(size_t msgs, size_t bytes) {
+        max_msgs_ = msgs;
+        max_bytes_ = bytes;
+    }
+
+    /** Can a request carrying the given number of bytes go now? The caller holds mtx_. */
+    bool fits_(size_t bytes) {
+        if (closed_ || msgs_ == 0) return true;
+        if (max_msgs_ > 0 && msgs_ >= max_msgs_) return false;
+        return max_bytes_ == 0 || bytes_ + bytes <= max_bytes_;
+    }
+
+    /** Waits for the credits for a request carrying the given number of bytes and takes them. */
+    void acquire(size_t bytes) {
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (!fits_(bytes)) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            while (!fits_(bytes)) cv_.wait(lk);
+            stalls_++;
+            stall_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        msgs_++;
+        bytes_ += bytes;
+    }
+
+    /** Returns the byte credits that a read of the given number of values takes. */
+    size_t read_estimate(size_t values) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return values * read_value_bytes_;
+    }
+
+    /**
+     * Records that a read of the given number of values got back the given number of bytes, so
+     * that later reads take credits closer to what they will get.
+     */
+    void settle_read(size_t values, size_t bytes) {
+        if (values == 0) return;
+        std::lock_guard<std::mutex> lk(mtx_);
+        // Each reply moves the average a quarter of the way to its own
+        read_value_bytes_ = (3 * read_value_bytes_ + bytes / values) / 4;
+    }
+
+    /** Gives back the credits taken by a request carrying the given number of bytes. */
+    void release(size_t bytes) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        msgs_--;
+        bytes_ -= bytes;
+        cv_.notify_all();
+    }
+
+    /** Lets every waiting and future request through, for when the node shuts down. */
+    void close() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+};
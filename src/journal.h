@@ -0,0 +1,360 @@
+//lang::Cpp
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sharded_map.h"
+
+// The first bytes of every snapshot file
+#define SNAPSHOT_MAGIC "EAU2SNP2"
+// The size of a snapshot's header: the magic and then the generation of the first log it omits
+#define SNAPSHOT_HEADER_SIZE 16
+// The size of the lengths that come before every record's key and value
+#define RECORD_HEADER_SIZE 16
+
+/**
+ * The on-disk copy of one node's map, so that a restarted node gets its data back without the
+ * application having to rebuild it.
+ *
+ * Every put is appended to a log as a record: the key's length and the value's length as 64-bit
+ * integers, then the key, then the value. Once the log grows past a threshold, snapshot() starts
+ * a new log and then writes every entry of the map to a snapshot file, after which the old logs
+ * are deleted. Logs are numbered by generation, and a snapshot names the first generation that it
+ * does not cover, so a restart maps the snapshot and replays just the logs from there on.
+ *
+ * A snapshot's records also end each value with a terminator, so a restart uses the values where
+ * they are mapped instead of reading them: only the keys are copied, and the snapshot stays
+ * mapped until the last of its values is replaced. Only the log records are copied out.
+ *
+ * append() only queues a record, since the KVStore calls it under a shard lock, and flush()
+ * writes the queued records out, all in one call, once the lock is let go. The queue keeps the
+ * order that the records were appended in. Records are not synced, so a put survives the process
+ * crashing but not the machine losing power. A record that was cut off by a crash is dropped on
+ * restart.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Journal : public Object {
+public:
+    // The directory that holds the files, owned
+    char* dir_;
+    // The index of the node whose map this is, which names its files
+    size_t idx_;
+    // The size that the log may grow to before the map should be snapshotted
+    size_t snapshot_bytes_;
+    // The open log, or -1 before recover() is called
+    int log_fd_;
+    // The generation of the open log
+    size_t gen_;
+    // The number of bytes in the open log
+    size_t log_bytes_;
+    // The records appended but not written yet, in order. The value handles keep them alive
+    std::vector<std::pair<std::string, Blob>> queued_;
+    // The lock that guards the open log, its generation, and queued_
+    std::mutex log_mtx_;
+    // Held while a snapshot is being written, so that only one is written at a time
+    std::mutex snap_mtx_;
+
+    /**
+     * Constructor for the journal of the given node in the given directory, which is created if
+     * it does not exist. Nothing is read or written until recover() is called.
+     */
+    Journal(const char* dir, size_t idx, size_t snapshot_bytes) : dir_(duplicate(dir)),
+        idx_(idx), snapshot_bytes_(snapshot_bytes), log_fd_(-1), gen_(0), log_bytes_(0) {
+        mkdir(dir_, 0755);
+    }
+
+    /** Destructor */
+    ~Journal() {
+        if (log_fd_ >= 0) {
+            write_queued_();
+            close(log_fd_);
+        }
+        delete[] dir_;
+    }
+
+    /** Returns the path of this node's snapshot. The caller owns the result. */
+    char* snapshot_path_() {
+        StrBuff buff(dir_);
+        buff.c("/node-");
+        buff.c(idx_);
+        buff.c(".snap");
+        return buff.c_str();
+    }
+
+    /** Returns the path of this node's log of the given generation. The caller owns the result. */
+    char* log_path_(size_t gen) {
+        StrBuff buff(dir_);
+        buff.c("/node-");
+        buff.c(idx_);
+        buff.c(".log.");
+        buff.c(gen);
+        return buff.c_str();
+    }
+
+    /**
+     * Puts every entry in this node's snapshot and logs into the given map, and then opens the
+     * log that new puts are appended to.
+     *
+     * @return The number of records read
+     */
+    size_t recover(ShardedMap& map) {
+        size_t records = 0;
+        size_t first_gen = 0;
+        char* path = snapshot_path_();
+        char* snap;
+        size_t len;
+        if (map_file_(path, &snap, &len, false)) {
+            exit_if_not(len >= SNAPSHOT_HEADER_SIZE &&
+                memcmp(snap, SNAPSHOT_MAGIC, SNAPSHOT_HEADER_SIZE / 2) == 0,
+                "The snapshot file is corrupt");
+            uint64_t gen;
+            memcpy(&gen, snap + SNAPSHOT_HEADER_SIZE / 2, sizeof(gen));
+            first_gen = gen;
+            // Unmapped once the last value that points into it lets go
+            size_t mapped_len = len;
+            std::shared_ptr<char> mapping(snap, [mapped_len](char* m) { munmap(m, mapped_len); });
+            size_t end = replay_(snap, SNAPSHOT_HEADER_SIZE, len, map, &records, mapping);
+            exit_if_not(end == len, "The snapshot file is corrupt");
+        }
+        delete[] path;
+        // Logs older than the snapshot were left behind by a crash right after it was written
+        remove_logs_before_(first_gen);
+        // Replay the logs that came after the snapshot in order, and keep appending to the last
+        gen_ = first_gen;
+        for (size_t gen = first_gen; ; gen++) {
+            char* log;
+            path = log_path_(gen);
+            bool found = map_file_(path, &log, &len, true);
+            delete[] path;
+            if (!found) break;
+            log_bytes_ = replay_(log, 0, len, map, &records);
+            if (log != nullptr) munmap(log, len);
+            gen_ = gen;
+        }
+        path = log_path_(gen_);
+        log_fd_ = open(path, O_WRONLY | O_CREAT, 0644);
+        exit_if_not(log_fd_ >= 0, "Could not open the log file");
+        // Drop a record at the end that a crash cut off
+        exit_if_not(ftruncate(log_fd_, log_bytes_) == 0, "Could not truncate the log file");
+        lseek(log_fd_, log_bytes_, SEEK_SET);
+        delete[] path;
+        return records;
+    }
+
+    /**
+     * Maps the file at the given path into memory read-only, setting data to its contents (or
+     * nullptr if it is empty) and len to its size. A file that is read once from start to end
+     * is mapped as sequential, so the kernel reads ahead and drops the pages behind.
+     *
+     * @return Whether the file exists
+     */
+    bool map_file_(const char* path, char** data, size_t* len, bool sequential) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        exit_if_not(fstat(fd, &st) == 0, "Could not stat a journal file");
+        *len = st.st_size;
+        *data = nullptr;
+        if (*len > 0) {
+            void* m = mmap(nullptr, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+            exit_if_not(m != MAP_FAILED, "Could not map a journal file");
+            if (sequential) madvise(m, *len, MADV_SEQUENTIAL);
+            *data = (char*)m;
+        }
+        close(fd);
+        return true;
+    }
+
+    /** Deletes every log older than the given generation. */
+    void remove_logs_before_(size_t gen) {
+        // The logs are numbered without gaps, so the first one that is missing ends the run
+        for (; gen > 0; gen--) {
+            char* path = log_path_(gen - 1);
+            int gone = unlink(path);
+            delete[] path;
+            if (gone != 0) break;
+        }
+    }
+
+    /**
+     * Puts every whole record in data[start, len) into the given map and adds them to records.
+     * Given the mapping that data belongs to, the records are a snapshot's, whose values each end
+     * in a terminator and are used in place. Otherwise they are a log's, and are copied out.
+     *
+     * @return The offset just past the last whole record
+     */
+    size_t replay_(const char* data, size_t start, size_t len, ShardedMap& map, size_t* records,
+        std::shared_ptr<char> mapping = nullptr) {
+        size_t i = start;
+        size_t terminator = mapping ? 1 : 0;
+        while (i + RECORD_HEADER_SIZE <= len) {
+            uint64_t klen, vlen;
+            memcpy(&klen, data + i, sizeof(klen));
+            memcpy(&vlen, data + i + sizeof(klen), sizeof(vlen));
+            // Keys are never empty, so a zero length is the unwritten end of a log
+            if (klen == 0 || len - i - RECORD_HEADER_SIZE < klen + vlen + terminator) break;
+            const char* key = data + i + RECORD_HEADER_SIZE;
+            char* kbuf = new char[klen + 1];
+            memcpy(kbuf, key, klen);
+            kbuf[klen] = '\0';
+            String k(true, kbuf, klen);
+            if (mapping) {
+                char* v = (char*)key + klen;
+                exit_if_not(v[vlen] == '\0', "The snapshot file is corrupt");
+                Blob value(v, vlen, [mapping]() { });
+                map.put(k, value);
+            } else {
+                char* v = new char[vlen + 1];
+                memcpy(v, key + klen, vlen);
+                v[vlen] = '\0';
+                Blob value(v);
+                map.put(k, value);
+            }
+            i += RECORD_HEADER_SIZE + klen + vlen + terminator;
+            (*records)++;
+        }
+        return i;
+    }
+
+    /**
+     * Appends a record of the given put to the log. The record is only queued, without copying
+     * the value, and is written by the next flush().
+     *
+     * @return Whether the log has grown past the size at which the map should be snapshotted
+     */
+    bool append(String& k, Blob& v) {
+        std::lock_guard<std::mutex> lk(log_mtx_);
+        queued_.push_back(std::make_pair(std::string(k.c_str(), k.size()), v));
+        log_bytes_ += RECORD_HEADER_SIZE + k.size() + v.size();
+        return log_bytes_ >= snapshot_bytes_;
+    }
+
+    /** Writes every queued record to the log. */
+    void flush() {
+        std::lock_guard<std::mutex> lk(log_mtx_);
+        write_queued_();
+    }
+
+    /**
+     * Writes the queued records to the open log with as few calls as it can, and empties the
+     * queue. The caller must hold log_mtx_.
+     */
+    void write_queued_() {
+        // Each record is written from three buffers: its lengths, its key, and its value
+        size_t per_call = IOV_MAX / 3;
+        std::vector<uint64_t> lens(2 * std::min(queued_.size(), per_call));
+        std::vector<struct iovec> iov(3 * lens.size() / 2);
+        for (size_t first = 0; first < queued_.size(); first += per_call) {
+            size_t n = std::min(queued_.size() - first, per_call);
+            size_t total = 0;
+            for (size_t i = 0; i < n; i++) {
+                std::pair<std::string, Blob>& r = queued_[first + i];
+                lens[2 * i] = r.first.size();
+                lens[2 * i + 1] = r.second.size();
+                iov[3 * i].iov_base = &lens[2 * i];
+                iov[3 * i].iov_len = RECORD_HEADER_SIZE;
+                iov[3 * i + 1].iov_base = (void*)r.first.data();
+                iov[3 * i + 1].iov_len = r.first.size();
+                iov[3 * i + 2].iov_base = r.second.c_str();
+                iov[3 * i + 2].iov_len = r.second.size();
+                total += RECORD_HEADER_SIZE + r.first.size() + r.second.size();
+            }
+            writev_all_(log_fd_, &iov[0], 3 * n, total);
+        }
+        queued_.clear();
+    }
+
+    /** Writes all of the bytes in the given buffers to the given file, exiting if it cannot. */
+    void writev_all_(int fd, struct iovec* iov, size_t cnt, size_t len) {
+        while (len > 0) {
+            ssize_t n = writev(fd, iov, cnt);
+            exit_if_not(n > 0, "Could not write to the log file");
+            len -= n;
+            // Skip the buffers that were written, and the written part of the next one
+            while (cnt > 0 && (size_t)n >= iov->iov_len) {
+                n -= iov->iov_len;
+                iov++;
+                cnt--;
+            }
+            if (cnt > 0) {
+                iov->iov_base = (char*)iov->iov_base + n;
+                iov->iov_len -= n;
+            }
+        }
+    }
+
+    /** Writes all of the given bytes to the given file, exiting if it cannot. */
+    void write_all_(int fd, const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = write(fd, data, len);
+            exit_if_not(n > 0, "Could not write to the log file");
+            data += n;
+            len -= n;
+        }
+    }
+
+    /**
+     * Writes every entry in the given map to a new snapshot and deletes the logs that it covers.
+     * Puts carry on while it is written: they go to a new log, which is replayed on top of the
+     * snapshot, so a put that lands in both is simply applied twice. Returns right away if
+     * another snapshot is already being written.
+     */
+    void snapshot(ShardedMap& map) {
+        std::unique_lock<std::mutex> snap_lk(snap_mtx_, std::try_to_lock);
+        if (!snap_lk.owns_lock()) return;
+        // Every put whose record is in an older log is already in the map, because puts append
+        // to the log while they hold their shard's lock
+        log_mtx_.lock();
+        size_t covered = gen_;
+        write_queued_();
+        close(log_fd_);
+        gen_++;
+        char* path = log_path_(gen_);
+        log_fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        exit_if_not(log_fd_ >= 0, "Could not open the log file");
+        log_bytes_ = 0;
+        delete[] path;
+        log_mtx_.unlock();
+
+        char* snap_path = snapshot_path_();
+        std::string tmp_path = std::string(snap_path) + ".tmp";
+        FILE* f = fopen(tmp_path.c_str(), "w");
+        exit_if_not(f != nullptr, "Could not open the snapshot file");
+        uint64_t gen = gen_;
+        fwrite(SNAPSHOT_MAGIC, 1, SNAPSHOT_HEADER_SIZE / 2, f);
+        fwrite(&gen, sizeof(gen), 1, f);
+        std::vector<std::pair<std::string, Blob>> entries;
+        for (size_t s = 0; s < map.shards(); s++) {
+            entries.clear();
+            map.entries(s, entries);
+            for (size_t i = 0; i < entries.size(); i++) {
+                uint64_t lens[2] = { entries[i].first.size(), entries[i].second.size() };
+                fwrite(lens, sizeof(lens), 1, f);
+                fwrite(entries[i].first.data(), 1, lens[0], f);
+                fwrite(entries[i].second.c_str(), 1, lens[1], f);
+                // The terminator, so that a restart can use the value where it is mapped
+                fputc('\0', f);
+            }
+        }
+        exit_if_not(fflush(f) == 0 && fsync(fileno(f)) == 0, "Could not write the snapshot file");
+        fclose(f);
+        exit_if_not(rename(tmp_path.c_str(), snap_path) == 0, "Could not replace the snapshot");
+        delete[] snap_path;
+        remove_logs_before_(covered + 1);
+    }
+};
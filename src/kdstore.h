@@ -15,31 +15,56 @@ class KDStore : public Object {
 public:
     KVStore kv_;
 
-    KDStore(size_t idx, size_t nodes) : kv_(idx, nodes) { }
+    KDStore(size_t idx, size_t nodes, KVConfig cfg = KVConfig()) : kv_(idx, nodes, cfg) { }
 
     /** Gets the DataFrame stored at the given key in the KVStore. */
     DataFrame* get(Key& k) {
-        const char* serialized_df = kv_.get(k);
-        Deserializer ds(serialized_df);
-        DataFrame* res = ds.deserialize_dataframe(&kv_, &k);
-        delete[] serialized_df;
-        return res;
+        Blob serialized_df = kv_.get(k);
+        Deserializer ds(serialized_df.c_str());
+        return ds.deserialize_dataframe(&kv_, &k);
     }
 
     /** Waits until the given key is put into the KVStore and then retrives its value. */
     DataFrame* wait_and_get(Key& k) {
-        const char* serialized_df = kv_.wait_and_get(k);
-        Deserializer ds(serialized_df);
-        DataFrame* res = ds.deserialize_dataframe(&kv_, &k);
-        delete[] serialized_df;
-        return res;
+        Blob serialized_df = kv_.wait_and_get(k);
+        Deserializer ds(serialized_df.c_str());
+        return ds.deserialize_dataframe(&kv_, &k);
     }
 
+    /**
+     * Returns a new Key for the DataFrame with the given name, on the node that the placement
+     * policy picks for it, so that named DataFrames are spread over the nodes rather than all
+     * kept on node 0. Every node gets the same Key for the same name.
+     */
+    Key* place(const char* name) { return new Key(name, kv_.placement()->home_of(name)); }
+
+    /**
+     * Hands the DataFrame built on the root node to every node, down a tree (see
+     * KVStore::broadcast()). Only the frame's serialized columns are sent, and its chunks stay
+     * where they are stored. Every node must call this with the same key and root.
+     *
+     * @param k    The key that the frame is known by, which must outlive the returned frame
+     * @param df   The frame to share on the root, which is returned as is; ignored elsewhere
+     * @return The frame, which the caller owns on every node other than the root, or nullptr if
+     *         this node shut down first
+     */
+    DataFrame* broadcast(Key& k, DataFrame* df, size_t root = 0) {
+        bool is_root = kv_.this_node() == root;
+        Blob serialized_df = kv_.broadcast(is_root ? df->serialize() : nullptr, root);
+        if (is_root) return df;
+        if (serialized_df.empty()) return nullptr;
+        Deserializer ds(serialized_df.c_str());
+        return ds.deserialize_dataframe(&kv_, &k);
+    }
+
+    /** Blocks until every node has called barrier() as many times as this one. */
+    void barrier() { kv_.barrier(); }
+
     /** Getter for this KDStore's associated KVStore. */
     KVStore* get_kv() { return &kv_; }
 
     /** Called when the application has finished its execution. */
-    void done() { kv_.shutdown(); }
+    void done() { kv_.done(); }
 };
 
 // DataFrame functions defined below to avoid circular dependencies
@@ -1,6 +1,6 @@
 //lang::CwC
 
-// Some of the code in this file, particularly the select() loops were interpreted from Beej's Guide to Socking Programming
+// Some of the code in this file, particularly the socket setup, was interpreted from Beej's Guide to Socking Programming
 
 #pragma once
 
@@ -14,19 +14,171 @@
 #include <assert.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <unistd.h>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <chrono>
 
 #include "map.h"
 #include "deserial.h"
+#include "config.h"
+#include "thread_pool.h"
+#include "sharded_map.h"
+#include "journal.h"
+#include "transport.h"
+#include "membership.h"
+#include "codec.h"
+#include "blob.h"
+#include "placement.h"
+#include "chunk_cache.h"
+#include "flow.h"
+#include "stats.h"
 
-#define PORT "8080"
-// The fixed number of nodes that this network supports (1 server, the rest are clients)
-#define BACKLOG 6
-// The size of the string buffer used to send messages
-#define BUF_SIZE 10000
+// The size of the buffer that recv() reads into
+#define BUF_SIZE 65536
+// The most events handled per call to epoll_wait()
+#define MAX_EVENTS 64
+// Marks a node that was not sent a request in a batched operation
+#define NO_REQUEST ((size_t)-1)
+// Marks a request that does not count against any node's FlowWindow
+#define NO_NODE ((size_t)-1)
+
+/**
+ * A remote request that this node has sent and is still waiting on an Ack or Reply for.
+ * 
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PendingRequest : public Object {
+public:
+    // Has the Ack or Reply for this request arrived?
+    bool done_;
+    // Has the sender stopped waiting for the response? The event loop then throws it away.
+    bool abandoned_;
+    // The data returned in the Reply, stays nullptr for Puts
+    const char* value_;
+    // The handles to the data returned in a MultiReply, stays nullptr for every other request
+    Blob* values_;
+    // The kind of message that the request was sent as
+    MsgKind kind_;
+    // The node whose FlowWindow the request took credits from, or NO_NODE
+    size_t node_;
+    // The number of byte credits that the request took
+    size_t bytes_;
+    // The number of values that the response to a Get or MultiGet will carry, otherwise 0
+    size_t reads_;
+    // When the request was sent
+    std::chrono::steady_clock::time_point start_;
+    // Signalled by the event loop when the response arrives or the node shuts down
+    std::condition_variable cv_;
+
+    /**
+     * Constructor for a request of the given kind that took credits for the given bytes from the
+     * given node
+     */
+    PendingRequest(MsgKind kind, size_t node, size_t bytes) : done_(false), abandoned_(false),
+        value_(nullptr),
+        values_(nullptr), kind_(kind), node_(node), bytes_(bytes), reads_(0),
+        start_(std::chrono::steady_clock::now()) { }
+};
+
+/**
+ * Everyone waiting for a key to be put into this node's store.
+ * 
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class KeyWatchers : public Object {
+public:
+    // The number of threads on this node blocked in wait_and_get() on the key
+    size_t local_;
+    // WaitAndGets sent by other nodes, each paired with the socket its Reply goes back over
+    std::vector<std::pair<WaitAndGet*, int>> remote_;
+    // Signalled when the key is put or the node shuts down. Waited on with the key's shard lock.
+    std::condition_variable_any cv_;
+
+    /** Constructor */
+    KeyWatchers() : local_(0) { }
+};
+
+/**
+ * The state kept for one open socket to another node.
+ * 
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Connection : public Object {
+public:
+    // The socket's file descriptor
+    int fd_;
+    // The header of the message currently being read
+    char hdr_[FRAME_HEADER_SIZE];
+    // The number of header bytes read so far
+    size_t hdr_got_;
+    // Has the header of the message currently being read been read in full?
+    bool in_body_;
+    // The serialized fields of the message currently being read, allocated once its header is
+    // complete
+    char* meta_;
+    // The length of the meta, taken from the header
+    size_t meta_len_;
+    // The value carried by the message currently being read, or nullptr if it carries none
+    char* blob_;
+    // The length of the value, taken from the header
+    size_t blob_len_;
+    // The number of meta and then value bytes read so far
+    size_t got_;
+    // The transport that the socket was opened through
+    Transport* transport_;
+    // The number of messages sent over the socket so far
+    std::atomic<size_t> sent_;
+    // The lock that keeps messages sent by different threads from interleaving on this socket
+    std::mutex send_mtx_;
+    // The index of the node on the other end, or NO_NODE until it is known
+    std::atomic<size_t> node_;
+
+    /** Constructor for a socket opened through the given transport */
+    Connection(int fd, Transport* t) : fd_(fd), hdr_got_(0), in_body_(false), meta_(nullptr),
+        meta_len_(0), blob_(nullptr), blob_len_(0), got_(0), transport_(t), sent_(0),
+        node_(NO_NODE) { }
+
+    /** Destructor */
+    ~Connection() {
+        delete[] meta_;
+        delete[] blob_;
+    }
+
+    /** Returns true if the message currently being read has been read in full. */
+    bool complete() { return in_body_ && got_ == meta_len_ + blob_len_; }
+
+    /**
+     * Returns where the next byte of the message currently being read belongs, and sets room to
+     * the number of bytes that fit there contiguously.
+     */
+    char* next(size_t* room) {
+        if (got_ < meta_len_) {
+            *room = meta_len_ - got_;
+            return meta_ + got_;
+        }
+        *room = meta_len_ + blob_len_ - got_;
+        return blob_ + (got_ - meta_len_);
+    }
+};
 
 /**
  * This class represents a key/value store maintained on one node from a larger distributed system.
@@ -42,37 +194,78 @@ public:
     size_t idx_;
     // Number of nodes in the system
     size_t num_nodes_;
-    // The map from string keys to deserialized data blobs
-    Map map_;
-    // Have we received an Ack?
-    bool ack_recvd_;
-    // Data returned in a Reply message after a Get message is sent
-    const char* reply_data_;
-    // Data returned in a Reply message after a WaitAndGet message is sent
-    // WaitAndGet gets its own variable so that there is no confusion between threads running both
-    // get operations
-    const char* wag_reply_data_;
-    // The thread that runs the select() loop
+    // The map from string keys to deserialized data blobs, split into independently locked shards
+    ShardedMap map_;
+    // The requests sent by this node that are still waiting for a response, keyed by request ID
+    std::unordered_map<size_t, PendingRequest*> pending_;
+    // The ID that will be given to the next request sent by this node
+    size_t next_id_;
+    // The thread that runs the event loop
     std::thread* t_;
-    // Vector of threads that process messages
-    std::vector<std::thread>* threads_;
-    // The lock that prevents data races
-    std::mutex mtx_;
+    // This node's settings
+    KVConfig cfg_;
+    // The worker threads that handle Puts, Gets, and WaitAndGets sent by other nodes
+    ThreadPool* pool_;
+    // For each shard of map_, the waiters on each key in it that has not been put yet. Guarded
+    // by the shard's lock.
+    std::unordered_map<std::string, KeyWatchers*>* watchers_;
+    // For each node, the IDs of the async puts sent to it that have not been acked yet, oldest
+    // first
+    std::deque<size_t>* in_flight_;
+    // The lock that guards in_flight_
+    std::mutex flight_mtx_;
+    // The number of barriers and collective operations this node has entered. Every node
+    // enters them in the same order, so this numbers the messages that belong to each one
+    size_t epoch_;
+    // The Barrier and Collective messages that have arrived but not been taken yet, by epoch and
+    // then sender, with the value that each one carries
+    std::map<std::pair<size_t, size_t>, Blob> inbox_;
+    // The lock that guards inbox_
+    std::mutex inbox_mtx_;
+    // Signalled when a message arrives in inbox_ or the node shuts down
+    std::condition_variable inbox_cv_;
+    // The lock that guards pending_, next_id_, and has_shutdown
+    std::mutex pending_mtx_;
     // has this node shut down?
-    bool has_shutdown;
+    std::atomic<bool> has_shutdown;
+    // The on-disk log and snapshot of map_, or nullptr if the data is only kept in memory
+    Journal* journal_;
+    // Picks the home of each chunk of the DataFrames built on this node, owned
+    PlacementPolicy* placement_;
+    // The chunks that DataFrames on this node fetched from other nodes, deserialized
+    ChunkCache chunk_cache_;
+    // For each node, the credits this node has for sending it requests
+    FlowWindow* flow_;
+    // The traffic, request latencies, and hot keys measured on this node
+    NodeStats stats_;
 
     /**
      * Constructor that initializes an empty KVStore.
      * 
      * @param idx   The index of the node running this KVStore.
      * @param nodes The total number of nodes running in the system.
+     * @param cfg   This node's settings
      */
-    KVStore(size_t idx, size_t nodes) : idx_(idx), num_nodes_(nodes), ack_recvd_(false),
-        reply_data_(nullptr), wag_reply_data_(nullptr) {
-        threads_ = new std::vector<std::thread>();
+    KVStore(size_t idx, size_t nodes, KVConfig cfg = KVConfig()) : idx_(idx), num_nodes_(nodes),
+        map_(cfg.map_shards_), next_id_(0), cfg_(cfg), epoch_(0),
+        journal_(nullptr), placement_(PlacementPolicy::make(cfg, nodes)),
+        chunk_cache_(cfg.chunk_cache_bytes_), stats_(idx, nodes) {
+        if (cfg_.memory_budget_ > 0) map_.set_budget(cfg_.memory_budget_, cfg_.spill_dir_, idx_);
+        // Get back whatever this node stored before it last stopped
+        if (cfg_.data_dir_ != nullptr) {
+            journal_ = new Journal(cfg_.data_dir_, idx_, cfg_.snapshot_bytes_);
+            journal_->recover(map_);
+        }
+        watchers_ = new std::unordered_map<std::string, KeyWatchers*>[map_.shards()];
+        pool_ = new ThreadPool(cfg_.handler_threads_);
+        in_flight_ = new std::deque<size_t>[num_nodes_];
+        flow_ = new FlowWindow[num_nodes_];
+        for (size_t i = 0; i < num_nodes_; i++) {
+            flow_[i].limit(cfg_.flow_messages_, cfg_.flow_bytes_);
+        }
         startup_();
-        // Wait a second for client registration to finish
-        sleep(1);
+        // Wait until every node is up
+        barrier();
     }
 
     /**
@@ -80,43 +273,209 @@ public:
      */
     ~KVStore() {
         t_->join();
-        for (std::thread& th : *threads_) {
-            if (th.joinable()) {
-                th.join();
+        delete t_;
+        // Let the workers finish whatever the event loop handed them before it stopped
+        delete pool_;
+        for (size_t j = 0; j < map_.shards(); j++) {
+            for (std::unordered_map<std::string, KeyWatchers*>::iterator it = watchers_[j].begin();
+                it != watchers_[j].end(); it++) {
+                for (size_t i = 0; i < it->second->remote_.size(); i++) {
+                    delete it->second->remote_[i].first->get_key();
+                    delete it->second->remote_[i].first;
+                }
+                delete it->second;
             }
         }
-        delete t_;
-        delete threads_;
+        delete[] watchers_;
+        // Only the requests that were given up on can still be here
+        for (std::unordered_map<size_t, PendingRequest*>::iterator it = pending_.begin();
+            it != pending_.end(); it++) {
+            delete[] it->second->values_;
+            delete it->second;
+        }
+        for (std::unordered_map<int, Connection*>::iterator it = conns_.begin();
+            it != conns_.end(); it++) {
+            delete it->second;
+        }
+        if (directory_ != nullptr) delete directory_;
+        close(epfd_);
+        close(wake_fd_);
+        delete members_;
+        delete placement_;
+        delete[] buffer_;
+        delete[] nodes_;
+        delete[] in_flight_;
+        delete[] flow_;
+        delete tcp_;
+        if (unix_ != nullptr) delete unix_;
+        if (journal_ != nullptr) delete journal_;
     }
 
     /**
-     * Serializes the given data and puts it into the map at the given key.
+     * Serializes the given data and puts it into the map at the given key. Waits for every async
+     * put this node has in flight first, so that anyone who sees this value also sees the data
+     * that was put before it.
      * 
      * @param k The key at which the data will be stored
      * @param v The serialized data that will be stored in the k/v store
      */
     void put(Key& k, const char* v) {
+        flush();
+        v = encode_(v);
         size_t dst_node = k.get_home_node();
         // Check if the key corresponds to this node
         if (dst_node == idx_) {
             // If so, put the data in this KVStore's map
-            mtx_.lock();
-            map_.put(*k.get_keystring(), new String(v));
-            mtx_.unlock();
+            store_local_(k, v);
         } else {
             // If not, send a Put message to the correct node
-            Put p(&k, v);
-            const char* msg = p.serialize();
-            send_to_node_(msg, dst_node);
+            size_t id = start_request_(MsgKind::Put, dst_node, strlen(v));
+            Put p(&k, v, id);
+            const char* msg = p.serialize_meta();
+            send_to_node_(msg, dst_node, v);
             // Wait for an Ack confirming that the data was stored successfully
-            while (!ack_recvd_) {
-                sleep(1);
-                if (has_shutdown) exit(-1);
-            }
-            ack_recvd_ = false;
+            await_request_(id);
             delete[] msg;
+            delete[] v;
         }
+    }
+
+    /**
+     * Puts the given data into the store at the given key without waiting for the home node to
+     * acknowledge it. At most KVConfig::put_window_ async puts to each node are in flight at a
+     * time; past that, this waits for the oldest one to the same node to be acked. The data is
+     * only guaranteed to be stored once flush() returns. Takes ownership of the value.
+     */
+    void put_async(Key& k, const char* v) {
+        v = encode_(v);
+        size_t dst_node = k.get_home_node();
+        if (dst_node == idx_) {
+            store_local_(k, v);
+            return;
+        }
+        size_t id = start_request_(MsgKind::Put, dst_node, strlen(v));
+        Put p(&k, v, id);
+        const char* msg = p.serialize_meta();
+        send_to_node_(msg, dst_node, v);
+        delete[] msg;
         delete[] v;
+        track_in_flight_(dst_node, id);
+    }
+
+    /**
+     * Like multi_put(), but without waiting for the other nodes to acknowledge their MultiPuts.
+     * Each MultiPut counts against its node's window like one put_async(). The data is only
+     * guaranteed to be stored once flush() returns.
+     */
+    void multi_put_async(Key** keys, const char** values, size_t n) {
+        for (size_t i = 0; i < n; i++) values[i] = encode_(values[i]);
+        for (size_t node = 0; node < num_nodes_; node++) {
+            if (node == idx_) continue;
+            size_t id = send_multi_put_(node, keys, values, n);
+            if (id != NO_REQUEST) track_in_flight_(node, id);
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (keys[i]->get_home_node() == idx_) store_local_(*keys[i], values[i]);
+            else delete[] values[i];
+        }
+    }
+
+    /**
+     * Blocks until every async put this node has sent has been acknowledged.
+     */
+    void flush() {
+        for (size_t node = 0; node < num_nodes_; node++) {
+            for (;;) {
+                flight_mtx_.lock();
+                if (in_flight_[node].empty()) {
+                    flight_mtx_.unlock();
+                    break;
+                }
+                size_t id = in_flight_[node].front();
+                in_flight_[node].pop_front();
+                flight_mtx_.unlock();
+                await_request_(id);
+            }
+        }
+    }
+
+    /**
+     * Records that the async put with the given ID is in flight to the given node, and then waits
+     * for the oldest ones to that node to be acked until the node's window has room again.
+     */
+    void track_in_flight_(size_t node, size_t id) {
+        flight_mtx_.lock();
+        in_flight_[node].push_back(id);
+        while (in_flight_[node].size() > cfg_.put_window_) {
+            size_t oldest = in_flight_[node].front();
+            in_flight_[node].pop_front();
+            flight_mtx_.unlock();
+            await_request_(oldest);
+            flight_mtx_.lock();
+        }
+        flight_mtx_.unlock();
+    }
+
+    /**
+     * Puts the given data into this node's map, and then wakes up every thread on this node and
+     * replies to every other node that was waiting for it. The map takes the given buffer as is
+     * rather than copying it.
+     */
+    void store_local_(Key& k, const char* v) {
+        store_local_(k, Blob(v));
+    }
+
+    /**
+     * Puts the given handle's data into this node's map, like store_local_() above, for values
+     * that are already held by a Blob, such as those that arrive in a MultiPut.
+     */
+    void store_local_(Key& k, Blob value) {
+        std::vector<std::pair<WaitAndGet*, int>> remote;
+        String* key = k.get_keystring();
+        std::unordered_map<std::string, KeyWatchers*>& watchers = watchers_[map_.shard_of(*key)];
+        RWLock& lock = map_.lock_for(*key);
+        lock.lock();
+        map_.put_locked(*key, value);
+        // The record is queued under the shard lock, so a snapshot that starts a new log after
+        // it also sees the value in the map, but it is written once the lock is let go
+        bool full = journal_ != nullptr && journal_->append(*key, value);
+        std::unordered_map<std::string, KeyWatchers*>::iterator it = watchers.find(key->c_str());
+        if (it != watchers.end()) {
+            KeyWatchers* w = it->second;
+            remote.swap(w->remote_);
+            if (w->local_ > 0) {
+                // The last local waiter to wake up removes the entry
+                w->cv_.notify_all();
+            } else {
+                watchers.erase(it);
+                delete w;
+            }
+        }
+        lock.unlock();
+        if (journal_ != nullptr) journal_->flush();
+        // This handle keeps the value alive while it is sent, even if another put replaces it
+        for (size_t i = 0; i < remote.size(); i++) {
+            WaitAndGet* wag = remote[i].first;
+            Reply r(value.c_str(), MsgKind::WaitAndGet, wag->get_id());
+            const char* msg = r.serialize_meta();
+            send_all_(remote[i].second, msg, value.c_str());
+            delete wag->get_key(); delete wag; delete[] msg;
+        }
+        map_.enforce_budget();
+        if (full) journal_->snapshot(map_);
+    }
+
+    /**
+     * Returns the waiters on the given key, creating the entry if there are none yet. The caller
+     * must hold the key's shard lock exclusively.
+     */
+    KeyWatchers* watchers_for_(String* key) {
+        std::unordered_map<std::string, KeyWatchers*>& watchers = watchers_[map_.shard_of(*key)];
+        std::unordered_map<std::string, KeyWatchers*>::iterator it = watchers.find(key->c_str());
+        if (it != watchers.end()) return it->second;
+        KeyWatchers* w = new KeyWatchers();
+        watchers[key->c_str()] = w;
+        return w;
     }
 
     /**
@@ -124,78 +483,629 @@ public:
      * 
      * @param k The key at which the reqested data is stored
      * 
-     * @return The serialized data blob
+     * @return A handle to the serialized data blob. A value from this node's map is shared with
+     *         the map rather than copied.
      */
-    const char* get(Key& k) {
+    Blob get(Key& k) {
         size_t dst_node = k.get_home_node();
-        const char* res;
+        Blob res;
         // Check if this key corresponds to this node
         if (dst_node == idx_) {
-            // If so, get the data from this KVStore's map
-            mtx_.lock();
-            String* serialized_data = dynamic_cast<String*>(map_.get(*k.get_keystring()));
-            assert(serialized_data != nullptr);
-            mtx_.unlock();
-            // Copy the data because the Map owns it
-            String* copy = serialized_data->clone();
-            res = copy->steal();
-            delete copy;
+            // If so, share the data in this KVStore's map
+            res = get_stored_(k);
         } else {
             // If not, send a Get message to the correct node
-            Get g(&k);
+            size_t id = start_request_(MsgKind::Get, dst_node, 0, 1);
+            Get g(&k, id);
             const char* msg = g.serialize();
             send_to_node_(msg, dst_node);
             // Wait for a reply with the desired data
-            while (reply_data_ == nullptr) {
-                sleep(1);
-                if (has_shutdown) exit(-1);
-            }
-            res = reply_data_;
-            reply_data_ = nullptr;
+            res = Blob(await_request_(id));
             delete[] msg;
         }
+        return decode_(res);
+    }
+
+    /**
+     * Returns a handle to the data stored in this node's map at the given key, in the form that
+     * it is stored and sent in. The key must be in the map.
+     */
+    Blob get_stored_(Key& k) {
+        Blob res = map_.get(*k.get_keystring());
+        assert(!res.empty());
         return res;
     }
 
+    /**
+     * Returns the data stored at the given key to answer another node's request, counting the
+     * read towards the hot keys. Only these reads are counted: the table is guarded by one lock,
+     * which local gets should not have to take, and a remote read is what makes a key hot for
+     * the cluster.
+     */
+    Blob serve_stored_(Key& k) {
+        stats_.hot_.hit(k.get_keystring()->c_str());
+        return get_stored_(k);
+    }
+
+    /**
+     * Returns the form of the given value that is stored and sent: compressed if compression is
+     * turned on and it makes the value smaller, and otherwise the value itself. Values that look
+     * compressed are always compressed, so that they decode to themselves. Takes ownership.
+     */
+    const char* encode_(const char* v) {
+        if (!cfg_.compress_ && !Codec::is_compressed(v)) return v;
+        char* c = Codec::compress(v, strlen(v));
+        if (c == nullptr) return v;
+        delete[] v;
+        return c;
+    }
+
+    /**
+     * Returns the value that the given stored value was made from. Compressed values are
+     * recognized whether or not this node compresses its own, and an uncompressed value is
+     * returned as the same handle.
+     */
+    Blob decode_(Blob& v) {
+        if (!Codec::is_compressed(v.c_str())) return v;
+        return Blob(Codec::decompress(v.c_str()));
+    }
+
     /**
      * Waits until there is data in the store at the given key, and then gets it, deserializes it,
      *  and returns it.
      * 
      * @param k The key at which the reqested data is stored
      * 
-     * @return The serialized data blob
+     * @return A handle to the serialized data blob
      */
-    const char* wait_and_get(Key& k) {
+    Blob wait_and_get(Key& k) {
         size_t dst_node = k.get_home_node();
         // Check if this key corresponds to this node
         if (dst_node == idx_) {
             // If so, wait until the data is put into this node's map
             String* key_string = k.get_keystring();
-            bool contains_key = map_.contains(*key_string);
-            while (!contains_key) {
-                sleep(1);
-                contains_key = map_.contains(*key_string);
-                if (has_shutdown) exit(-1);
+            std::unique_lock<RWLock> lk(map_.lock_for(*key_string));
+            if (!map_.contains_locked(*key_string)) {
+                KeyWatchers* w = watchers_for_(key_string);
+                w->local_++;
+                while (!map_.contains_locked(*key_string) && !has_shutdown) w->cv_.wait(lk);
+                w->local_--;
+                if (w->local_ == 0 && w->remote_.empty()) {
+                    watchers_[map_.shard_of(*key_string)].erase(key_string->c_str());
+                    delete w;
+                }
+                // Only a shutdown ends the wait without the key
+                exit_if_not(map_.contains_locked(*key_string),
+                    "The node shut down while waiting for a key");
             }
+            lk.unlock();
             // Get the data
             return get(k);
         } else {
             // If not, send a WaitAndGet message to the correct node
-            WaitAndGet wag(&k);
+            size_t id = start_request_(MsgKind::WaitAndGet, NO_NODE, 0);
+            WaitAndGet wag(&k, id);
             const char* msg = wag.serialize();
             send_to_node_(msg, dst_node);
             // Wait for a reply with the desired data
-            while (wag_reply_data_ == nullptr) {
-                sleep(1);
-                if (has_shutdown) exit(-1);
-            }
-            const char* res = wag_reply_data_;
-            wag_reply_data_ = nullptr;
+            Blob res(await_request_(id));
             delete[] msg;
-            return res;
+            return decode_(res);
         }
     }
 
+    /**
+     * Puts each of the given values into the store at the matching key. The keys are grouped by
+     * home node so that each other node gets one MultiPut for all of its keys, and all of those
+     * are in flight at once. Takes ownership of the values, like put(), but not of the arrays.
+     * 
+     * @param keys   The keys at which the data will be stored
+     * @param values The serialized data that will be stored at each key
+     * @param n      The number of keys and values
+     */
+    void multi_put(Key** keys, const char** values, size_t n) {
+        flush();
+        for (size_t i = 0; i < n; i++) values[i] = encode_(values[i]);
+        size_t* ids = new size_t[num_nodes_];
+        for (size_t node = 0; node < num_nodes_; node++) {
+            ids[node] = node == idx_ ? NO_REQUEST : send_multi_put_(node, keys, values, n);
+        }
+        // Store the local values while the other nodes handle theirs
+        for (size_t i = 0; i < n; i++) {
+            if (keys[i]->get_home_node() == idx_) store_local_(*keys[i], values[i]);
+            else delete[] values[i];
+        }
+        // Wait for an Ack from every node that was sent a MultiPut
+        for (size_t node = 0; node < num_nodes_; node++) {
+            if (ids[node] != NO_REQUEST) await_request_(ids[node]);
+        }
+        delete[] ids;
+    }
+
+    /**
+     * Sends the given node one MultiPut holding every one of the given keys and values that is
+     * homed on it. The values are not deleted.
+     * 
+     * @return The ID of the request, or NO_REQUEST if none of the keys are homed on the node
+     */
+    size_t send_multi_put_(size_t node, Key** keys, const char** values, size_t n) {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (keys[i]->get_home_node() == node) count++;
+        }
+        if (count == 0) return NO_REQUEST;
+        Key** node_keys = new Key*[count];
+        const char** node_values = new const char*[count];
+        size_t bytes = 0;
+        count = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (keys[i]->get_home_node() != node) continue;
+            node_keys[count] = keys[i];
+            node_values[count] = values[i];
+            bytes += strlen(values[i]);
+            count++;
+        }
+        size_t id = start_request_(MsgKind::MultiPut, node, bytes);
+        MultiPut mp(node_keys, node_values, count, id);
+        const char* msg = mp.serialize_meta();
+        send_to_node_(msg, node, node_values, count);
+        delete[] msg;
+        return id;
+    }
+
+    /**
+     * Gets the data stored at each of the given keys. The keys are grouped by home node so that
+     * each other node gets one MultiGet for all of its keys, and all of those are in flight at
+     * once.
+     * 
+     * @param keys The keys at which the requested data is stored
+     * @param n    The number of keys
+     * 
+     * @return An array holding a handle to the serialized data blob for each key, in the same
+     *         order as the keys. The caller owns the array.
+     */
+    Blob* multi_get(Key** keys, size_t n) {
+        Blob* res = new Blob[n];
+        size_t* ids = new size_t[num_nodes_];
+        for (size_t node = 0; node < num_nodes_; node++) {
+            ids[node] = NO_REQUEST;
+            size_t count = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (keys[i]->get_home_node() == node) count++;
+            }
+            if (count == 0 || node == idx_) continue;
+            Key** node_keys = new Key*[count];
+            count = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (keys[i]->get_home_node() == node) node_keys[count++] = keys[i];
+            }
+            ids[node] = send_multi_get_(node, node_keys, count);
+        }
+        // Get the local values while the other nodes look up theirs
+        for (size_t i = 0; i < n; i++) {
+            if (keys[i]->get_home_node() == idx_) res[i] = get(*keys[i]);
+        }
+        for (size_t node = 0; node < num_nodes_; node++) {
+            if (ids[node] == NO_REQUEST) continue;
+            Blob* values = await_multi_request_(ids[node]);
+            // The MultiReply holds the values in the order that they were requested in
+            size_t count = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (keys[i]->get_home_node() == node) res[i] = decode_(values[count++]);
+            }
+            delete[] values;
+        }
+        delete[] ids;
+        return res;
+    }
+
+    /**
+     * Starts getting the data stored at each of the given keys, which must all live on the same
+     * other node, and returns without waiting for it. Every call must be matched with either
+     * await_multi_get(), which collects the values, or cancel_multi_get().
+     *
+     * @return The ID of the MultiGet that was sent
+     */
+    size_t multi_get_async(Key** keys, size_t n) {
+        size_t node = keys[0]->get_home_node();
+        exit_if_not(node != idx_, "multi_get_async() is for keys on other nodes");
+        Key** node_keys = new Key*[n];
+        for (size_t i = 0; i < n; i++) {
+            exit_if_not(keys[i]->get_home_node() == node, "Keys must all live on the same node");
+            node_keys[i] = keys[i];
+        }
+        return send_multi_get_(node, node_keys, n);
+    }
+
+    /**
+     * Waits for the values of the MultiGet with the given ID, sent by multi_get_async() for the
+     * given number of keys.
+     *
+     * @return An array holding a handle to the data at each key, in the same order as the keys.
+     *         The caller owns the array.
+     */
+    Blob* await_multi_get(size_t id, size_t n) {
+        Blob* res = new Blob[n];
+        Blob* values = await_multi_request_(id);
+        for (size_t i = 0; i < n; i++) res[i] = decode_(values[i]);
+        delete[] values;
+        return res;
+    }
+
+    /**
+     * Gives up on the MultiGet with the given ID, sent by multi_get_async(), without waiting for
+     * it. Its values are thrown away when they arrive, and its credits are given back then.
+     */
+    void cancel_multi_get(size_t id) {
+        std::lock_guard<std::mutex> lk(pending_mtx_);
+        std::unordered_map<size_t, PendingRequest*>::iterator it = pending_.find(id);
+        exit_if_not(it != pending_.end(), "Cancelled an unknown request");
+        PendingRequest* req = it->second;
+        if (!req->done_) {
+            req->abandoned_ = true;
+            return;
+        }
+        pending_.erase(it);
+        delete[] req->values_;
+        delete req;
+    }
+
+    /**
+     * Sends the given node one MultiGet for the given keys, which the message takes ownership
+     * of the array of.
+     *
+     * @return The ID of the request
+     */
+    size_t send_multi_get_(size_t node, Key** keys, size_t n) {
+        size_t id = start_request_(MsgKind::MultiGet, node, 0, n);
+        MultiGet mg(keys, n, id);
+        const char* msg = mg.serialize();
+        send_to_node_(msg, node);
+        delete[] msg;
+        return id;
+    }
+
+    /**
+     * Registers a new outstanding request of the given kind and returns the ID that its response
+     * will carry. A request that moves data to or from the given node first waits for credits in
+     * the node's FlowWindow for itself and the given number of value bytes, which its response
+     * gives back. A read that asks for the given number of values also takes credits for the
+     * node's estimate of their size (see FlowWindow::read_estimate()), so reads are limited by
+     * the bytes their replies carry too; the reply corrects the estimate when it arrives.
+     * Requests that may wait indefinitely, such as WaitAndGets, pass NO_NODE and take none.
+     */
+    size_t start_request_(MsgKind kind, size_t node, size_t bytes, size_t reads = 0) {
+        if (node != NO_NODE) {
+            bytes += flow_[node].read_estimate(reads);
+            flow_[node].acquire(bytes);
+        }
+        std::lock_guard<std::mutex> lk(pending_mtx_);
+        size_t id = next_id_++;
+        pending_[id] = new PendingRequest(kind, node, bytes);
+        pending_[id]->reads_ = reads;
+        return id;
+    }
+
+    /**
+     * Blocks until the response to the request with the given ID arrives.
+     * 
+     * @return The data carried by the Reply, or nullptr if the request was a Put
+     */
+    const char* await_request_(size_t id) {
+        PendingRequest* req = wait_for_request_(id);
+        const char* res = req->value_;
+        delete req;
+        return res;
+    }
+
+    /**
+     * Blocks until the MultiReply to the MultiGet with the given ID arrives.
+     * 
+     * @return The array of data carried by the MultiReply, which the caller owns
+     */
+    Blob* await_multi_request_(size_t id) {
+        PendingRequest* req = wait_for_request_(id);
+        Blob* res = req->values_;
+        delete req;
+        return res;
+    }
+
+    /**
+     * Blocks until the response to the request with the given ID arrives, and then removes the
+     * request from the table and returns it. Exits if the node shuts down first, since the
+     * response will then never come.
+     */
+    PendingRequest* wait_for_request_(size_t id) {
+        std::unique_lock<std::mutex> lk(pending_mtx_);
+        PendingRequest* req = pending_[id];
+        while (!req->done_ && !has_shutdown) req->cv_.wait(lk);
+        exit_if_not(req->done_, "The node shut down while waiting for a response");
+        pending_.erase(id);
+        return req;
+    }
+
+    /**
+     * Called by the event loop when the response to one of this node's requests arrives, which
+     * carried the given number of value bytes. Hands the data to the waiting thread and wakes it
+     * up, and records how long the request took.
+     */
+    void complete_request_(size_t id, const char* v, Blob* vs = nullptr, size_t bytes = 0) {
+        std::lock_guard<std::mutex> lk(pending_mtx_);
+        std::unordered_map<size_t, PendingRequest*>::iterator it = pending_.find(id);
+        exit_if_not(it != pending_.end(), "Received a response to an unknown request");
+        stats_.answered((size_t)it->second->kind_, it->second->node_,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - it->second->start_).count());
+        if (it->second->node_ != NO_NODE) {
+            flow_[it->second->node_].settle_read(it->second->reads_, bytes);
+            flow_[it->second->node_].release(it->second->bytes_);
+        }
+        if (it->second->abandoned_) {
+            // Nobody is waiting for this one
+            delete[] v;
+            delete[] vs;
+            delete it->second;
+            pending_.erase(it);
+            return;
+        }
+        it->second->value_ = v;
+        it->second->values_ = vs;
+        it->second->done_ = true;
+        it->second->cv_.notify_one();
+    }
+
+    /**
+     * Blocks until every node in the cluster has called barrier() as many times as this one.
+     * Waits for this node's async puts first, so that everything put before the barrier on any
+     * node can be read after it on every node. Only one thread per node may be in a barrier or
+     * a collective operation at a time.
+     *
+     * This is a dissemination barrier: in round r every node tells the node 2^r after it that it
+     * got this far and waits to hear the same from the node 2^r before it. After ceil(log2(N))
+     * rounds every node has heard, through some chain, from every other one.
+     */
+    void barrier() {
+        flush();
+        size_t epoch = epoch_++;
+        Barrier b(epoch, idx_);
+        const char* msg = b.serialize();
+        for (size_t dist = 1; dist < num_nodes_ && !has_shutdown; dist *= 2) {
+            send_to_node_(msg, (idx_ + dist) % num_nodes_);
+            receive_(epoch, (idx_ + num_nodes_ - dist) % num_nodes_);
+        }
+        delete[] msg;
+    }
+
+    /**
+     * Hands the given value from the root node to every node, down a binomial tree: each node
+     * that has the value passes it on to the nodes 2^k after it, so all of them have it after
+     * ceil(log2(N)) rounds instead of the root sending it N - 1 times. Every node must call this
+     * with the same root. The root gives up ownership of the value, and the others pass nullptr.
+     *
+     * @return The value, on every node, or an empty Blob if this node shut down first
+     */
+    Blob broadcast(const char* v, size_t root = 0) {
+        exit_if_not(root < num_nodes_, "Invalid root node index");
+        size_t epoch = epoch_++;
+        Blob res;
+        // Number the nodes from the root, so that the tree is the same for any root
+        size_t rel = (idx_ + num_nodes_ - root) % num_nodes_;
+        size_t mask = 1;
+        if (rel == 0) res = Blob(v);
+        while (mask < num_nodes_) {
+            if (rel & mask) {
+                res = receive_(epoch, (rel - mask + root) % num_nodes_);
+                break;
+            }
+            mask <<= 1;
+        }
+        for (mask >>= 1; mask > 0 && !has_shutdown; mask >>= 1) {
+            if (rel + mask < num_nodes_) {
+                send_collective_(epoch, (rel + mask + root) % num_nodes_, res.c_str());
+            }
+        }
+        return res;
+    }
+
+    /**
+     * Combines the values of all nodes into one on the root node, up a binomial tree, in
+     * ceil(log2(N)) rounds. Each node gives up ownership of its value. The given function is
+     * called with two values, of which the first comes from nodes numbered before the second's
+     * counting from the root, and returns a new value that the caller owns; it does not need to
+     * be commutative, but must be associative. Every node must call this with the same root.
+     *
+     * @return The combined value on the root, and an empty Blob on the other nodes or if this
+     *         node shut down first
+     */
+    Blob reduce(const char* v, std::function<const char*(const char*, const char*)> combine,
+        size_t root = 0) {
+        exit_if_not(root < num_nodes_, "Invalid root node index");
+        size_t epoch = epoch_++;
+        Blob acc(v);
+        size_t rel = (idx_ + num_nodes_ - root) % num_nodes_;
+        for (size_t mask = 1; mask < num_nodes_ && !has_shutdown; mask <<= 1) {
+            if (rel & mask) {
+                // This node's part of the tree is combined, so pass it up and drop out
+                send_collective_(epoch, (rel - mask + root) % num_nodes_, acc.c_str());
+                return Blob();
+            }
+            if (rel + mask < num_nodes_) {
+                Blob other = receive_(epoch, (rel + mask + root) % num_nodes_);
+                if (other.empty()) return Blob();
+                acc = Blob(combine(acc.c_str(), other.c_str()));
+            }
+        }
+        if (has_shutdown) return Blob();
+        return acc;
+    }
+
+    /**
+     * Hands the value of every node to every node. The values are gathered up a tree to node 0
+     * and the whole set is broadcast back down it, so this takes 2 * ceil(log2(N)) rounds rather
+     * than N - 1 round trips to each other node. Each node gives up ownership of its value.
+     *
+     * @return An array of the N values by node, which the caller owns. The values are empty if
+     *         this node shut down first.
+     */
+    Blob* allgather(const char* v) {
+        // Each part is the number of values in a run of nodes, their lengths, and then the values
+        StrBuff own;
+        char* count = Serializer::serialize_size_t(1);
+        char* len = Serializer::serialize_size_t(strlen(v));
+        own.c(count).c(len).c(v);
+        delete[] count; delete[] len; delete[] v;
+        Blob all = broadcast(reduce(own.c_str(), join_parts_).copy());
+        Blob* res = new Blob[num_nodes_];
+        if (all.empty()) return res;
+        Deserializer ds(all.c_str());
+        exit_if_not(ds.deserialize_size_t() == num_nodes_, "Allgather lost a value");
+        size_t* lens = new size_t[num_nodes_];
+        for (size_t i = 0; i < num_nodes_; i++) lens[i] = ds.deserialize_size_t();
+        const char* vals = all.c_str() + ds.i_;
+        for (size_t i = 0; i < num_nodes_; i++) {
+            char* val = new char[lens[i] + 1];
+            memcpy(val, vals, lens[i]);
+            val[lens[i]] = '\0';
+            vals += lens[i];
+            res[i] = Blob(val);
+        }
+        delete[] lens;
+        return res;
+    }
+
+    /**
+     * Joins two parts of an allgather, the first for the nodes before the second's, into one
+     * with all of the lengths ahead of all of the values. Returns the new part, which the caller
+     * owns.
+     */
+    static const char* join_parts_(const char* a, const char* b) {
+        Deserializer da(a);
+        Deserializer db(b);
+        size_t na = da.deserialize_size_t();
+        size_t nb = db.deserialize_size_t();
+        size_t a_lens = da.i_;
+        size_t b_lens = db.i_;
+        for (size_t i = 0; i < na; i++) da.deserialize_size_t();
+        for (size_t i = 0; i < nb; i++) db.deserialize_size_t();
+        StrBuff buff;
+        char* count = Serializer::serialize_size_t(na + nb);
+        buff.c(count);
+        delete[] count;
+        buff.c(a + a_lens, da.i_ - a_lens).c(b + b_lens, db.i_ - b_lens);
+        buff.c(a + da.i_).c(b + db.i_);
+        return buff.c_str();
+    }
+
+    /**
+     * Sends the given value, as this node's part of the collective operation with the given
+     * number, to the given node.
+     */
+    void send_collective_(size_t epoch, size_t dst, const char* v) {
+        Collective c(epoch, idx_, v);
+        const char* msg = c.serialize_meta();
+        send_to_node_(msg, dst, v);
+        delete[] msg;
+    }
+
+    /**
+     * Waits for the given node's message in the barrier or collective operation with the given
+     * number, and takes it out of the inbox.
+     *
+     * @return The value that the message carried, or an empty Blob if this node shut down first
+     */
+    Blob receive_(size_t epoch, size_t sender) {
+        std::pair<size_t, size_t> slot(epoch, sender);
+        std::unique_lock<std::mutex> lk(inbox_mtx_);
+        std::map<std::pair<size_t, size_t>, Blob>::iterator it;
+        while ((it = inbox_.find(slot)) == inbox_.end() && !has_shutdown) inbox_cv_.wait(lk);
+        if (it == inbox_.end()) return Blob();
+        Blob res = it->second;
+        inbox_.erase(it);
+        return res;
+    }
+
+    /**
+     * Called by every node once it has finished its part of the application. Waits until every
+     * other node is done too, so that none of them loses the data on this node while still using
+     * it, and then shuts this node down.
+     */
+    void done() {
+        barrier();
+        // Leave a compact snapshot behind so that the next start does not replay a long log
+        if (journal_ != nullptr) journal_->snapshot(map_);
+        shutdown();
+    }
+
+    /**
+     * Is there data at the given key in this node's map? Only answers for keys that live on
+     * this node, for example to check whether a restarted node got a key back from its journal.
+     */
+    bool has_local(Key& k) {
+        exit_if_not(k.get_home_node() == idx_, "Key does not live on this node");
+        return map_.contains(*k.get_keystring());
+    }
+
+    /** Returns the policy that places the chunks of the DataFrames built on this node. */
+    PlacementPolicy* placement() { return placement_; }
+
+    /** Replaces the placement policy with the given one, which this store takes ownership of. */
+    void set_placement(PlacementPolicy* p) {
+        delete placement_;
+        placement_ = p;
+    }
+
+    /** Returns the cache of chunks that this node fetched from other nodes. */
+    ChunkCache* chunk_cache() { return &chunk_cache_; }
+
+    /** Returns the number of requests to the given node that had to wait for credits. */
+    size_t flow_stalls(size_t node) { return flow_[node].stalls_; }
+
+    /** Returns the total time that requests to the given node waited for credits, in us. */
+    size_t flow_stall_us(size_t node) { return flow_[node].stall_us_; }
+
+    /**
+     * Returns the given node's report of its traffic, request latencies, and hottest keys, as
+     * described by NodeStats::report(), followed by a "stall <node> <requests> <us>" line for
+     * each node that it had to wait for credits to send to. Asks the node for it over the
+     * network unless it is this one. The caller owns the report.
+     */
+    const char* stats(size_t node) {
+        exit_if_not(node < num_nodes_, "Invalid node index");
+        if (node == idx_) return report_();
+        size_t id = start_request_(MsgKind::Stats, NO_NODE, 0);
+        Stats s(id);
+        const char* msg = s.serialize();
+        send_to_node_(msg, node);
+        const char* res = await_request_(id);
+        delete[] msg;
+        return res;
+    }
+
+    /** Returns this node's part of stats(), which the caller owns. */
+    char* report_() {
+        char* counters = stats_.report(kind_name);
+        StrBuff buff(counters);
+        delete[] counters;
+        for (size_t n = 0; n < num_nodes_; n++) {
+            if (flow_[n].stalls_ == 0) continue;
+            buff.c("stall ").c(n).c(" ").c(flow_[n].stalls_).c(" ");
+            buff.c(flow_[n].stall_us_).c("\n");
+        }
+        return buff.c_str();
+    }
+
+    /** Returns the number of value bytes that this node holds on the heap. */
+    size_t resident_bytes() { return map_.resident_; }
+
+    /** Returns the number of value bytes that this node has in its spill file. */
+    size_t spilled_bytes() { return map_.spill_ ? map_.spill_->bytes_.load() : 0; }
+
+    /** Returns the number of times that this node has spilled a value to stay in its budget. */
+    size_t spills() { return map_.spills_; }
+
+    /** Returns the number of times that this node has read a spilled value back in. */
+    size_t reloads() { return map_.reloads_; }
+
     /** Retuns the number of nodes running in the system. */
     size_t num_nodes() { return num_nodes_; }
 
@@ -204,34 +1114,38 @@ public:
 
     // ############################# NETWORK-SPECIFIC FIELDS AND METHODS ###########################
 
-    char* ip_;
-    // This node's socket file descriptor
+    // The address of every node, as far as this node knows
+    Membership* members_;
+    // The transport used to reach nodes on other hosts
+    Transport* tcp_;
+    // The transport used to reach nodes on this host, or nullptr if they also use TCP. With
+    // KVConfig::loopback_ it is the in-process transport, and it is used to reach every node
+    Transport* unix_;
+    // This node's listening TCP socket file descriptor, or -1 with KVConfig::loopback_
     int fd_;
-    // struct that will be filled with basic info in order to generate
-    // other full structs used to build sockets
-    struct addrinfo hints_;
-    // The file descriptor and address info of another node connecting to this once
-    int their_fd_;
-    struct sockaddr_storage their_addr_;
-    // A string buffer used to send messages
+    // This node's listening Unix socket file descriptor, or -1 if unix_ is nullptr
+    int local_fd_;
+    // The buffer that recv() reads into
     char* buffer_;
-    // An array of socket file descriptors to the other nodes
-    // The array indices are the node indices of each node
+    // An array of socket file descriptors to the other nodes, or -1 where no connection has been
+    // opened yet. The array indices are the node indices of each node
     int* nodes_;
-    // master file descriptor list
-    fd_set master_;
-    // temporary fd list used by select()
-    fd_set read_fds_;
-    // the maxmimum fd value in the master list
-    int fdmax_;
-
-    // The server's directory containing every client IP
+    // The lock that guards nodes_ and members_
+    std::mutex nodes_mtx_;
+    // Signalled when the address of another node becomes known or the node shuts down
+    std::condition_variable nodes_cv_;
+    // The open connections to other nodes, keyed by socket fd
+    std::unordered_map<int, Connection*> conns_;
+    // The lock that guards conns_
+    std::mutex conns_mtx_;
+    // The epoll instance that the event loop waits on
+    int epfd_;
+    // An eventfd that shutdown() writes to in order to wake the event loop
+    int wake_fd_;
+
+    // The server's directory containing every client address
     // Used by the server only
     Directory* directory_;
-    
-    // The file descriptor for the socket connected to the Server
-    // Used by the client only
-    int servfd_;
 
     /**
      * Is this node running the role of the server?
@@ -240,210 +1154,512 @@ public:
 
     /**
      * Startup protocol.
-     * Creates the socket that clients will connect to this node through.
-     * If this is a client, it also creates a socket to the server and sends it a message containing
-     * the client's IP and node index.
-     * 
-     * @param idx The index of the current node.
+     * Works out the address of this node and the server, from the membership file if there is
+     * one, and creates the sockets that other nodes will connect to this node through.
+     * If this is a client, it also connects to the server and sends it a Register message
+     * containing the client's address and node index, which the server answers with the
+     * Directory of every client it knows about.
      */
     void startup_() {
         buffer_ = new char[BUF_SIZE];
-        ip_ = idx_to_ip_(idx_);
+        if (cfg_.members_file_ != nullptr) {
+            members_ = Membership::from_file(cfg_.members_file_, num_nodes_);
+        } else {
+            members_ = new Membership(num_nodes_);
+            char* addr = cfg_.address_ != nullptr ? duplicate(cfg_.address_)
+                : Membership::default_address(idx_);
+            members_->set(idx_, addr);
+            delete[] addr;
+            if (!is_server()) {
+                addr = cfg_.server_address_ != nullptr ? duplicate(cfg_.server_address_)
+                    : Membership::default_address(0);
+                members_->set(0, addr);
+                delete[] addr;
+            }
+        }
+        const char* host = members_->host(idx_);
+        const char* port = members_->port(idx_);
         has_shutdown = false;
+        directory_ = nullptr;
         // This is an array that maps the indices of each node to their socket fds
-        nodes_ = new int[BACKLOG];
-        for (int i = 0; i < BACKLOG; i++) nodes_[i] = -1;
-
-        // Fill an addrinfo struct for this node, configuring its options, address, and port
-        struct addrinfo *info;
-        memset(&hints_, 0, sizeof(hints_));
-        hints_.ai_family = AF_INET;
-        hints_.ai_socktype = SOCK_STREAM;
-        exit_if_not(getaddrinfo(ip_, PORT, &hints_, &info) == 0, "Call to getaddrinfo() failed");
-        // Use the struct to create a socket
-        exit_if_not((fd_ = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) >= 0,
-            "Call to socket() failed");
-        // Bind the IP and port to the socket
-        exit_if_not(bind(fd_, info->ai_addr, info->ai_addrlen) >= 0, "Call to bind() failed");
-        freeaddrinfo(info);
+        nodes_ = new int[num_nodes_];
+        for (int i = 0; i < num_nodes_; i++) nodes_[i] = -1;
+        // Create the epoll instance and the eventfd used to wake it up
+        exit_if_not((epfd_ = epoll_create1(0)) >= 0, "Call to epoll_create1() failed");
+        exit_if_not((wake_fd_ = eventfd(0, EFD_NONBLOCK)) >= 0, "Call to eventfd() failed");
+        watch_fd_(wake_fd_);
+
+        // Listen for nodes on other hosts over TCP and, unless turned off, for nodes on this host
+        // over a Unix socket. A node in an in-process cluster only listens on the loopback
+        tcp_ = new TcpTransport();
+        unix_ = nullptr;
+        if (cfg_.loopback_) {
+            unix_ = new LoopbackTransport(cfg_.net_latency_us_, cfg_.net_jitter_us_,
+                cfg_.net_bytes_per_sec_, cfg_.net_seed_);
+        } else if (cfg_.local_transport_) {
+            unix_ = new UnixTransport();
+        }
+        fd_ = -1;
+        if (!cfg_.loopback_) {
+            fd_ = tcp_->listen_on(host, port);
+            set_nonblocking_(fd_);
+            watch_fd_(fd_);
+        }
+        local_fd_ = -1;
+        if (unix_ != nullptr) {
+            local_fd_ = unix_->listen_on(host, port);
+            set_nonblocking_(local_fd_);
+            watch_fd_(local_fd_);
+        }
         if (is_server()) {
             directory_ = new Directory();
-        } else {
-            // Wait a bit for the server to start up
-            usleep(250000);
-            // Calculate the server's IP using its node index (always 0) and use that to generate 
-            // another struct
-            struct addrinfo *servinfo;
-            char* serv_ip = idx_to_ip_(0);
-            exit_if_not(getaddrinfo(serv_ip, PORT, &hints_, &servinfo) == 0,
-                "Call to getaddrinfo() failed");
-            // Create the socket to the Server
-            exit_if_not((servfd_ = socket(servinfo->ai_family, servinfo->ai_socktype, 
-                servinfo->ai_protocol)) >= 0, "Call to socket() failed");
-            // Connect to the Server
-            int cnct = connect(servfd_, servinfo->ai_addr, servinfo->ai_addrlen);
-            while (cnct < 0) {
-                // Wait indefinitely until the lead node is available
-                p("Node ", idx_).p(idx_, idx_).pln(": Connection to lead node failed.", idx_);
-                sleep(1);
-                cnct = connect(servfd_, servinfo->ai_addr, servinfo->ai_addrlen);
-                if (has_shutdown) exit(-1);
-            }
-            p("Node ", idx_).p(idx_, idx_).pln(": Connection to lead node succeeded.", idx_);
-            // Add the server fd to the fd/idx map
-            nodes_[0] = servfd_;
-            freeaddrinfo(servinfo);
-            // Send IP to server in a Register message
-            Register reg(new String(ip_), idx_);
-            const char* msg = reg.serialize();
-            exit_if_not(send(servfd_, msg, strlen(msg) + 1, 0) > 0, "Sending IP to server failed");
-            delete[] msg; delete[] serv_ip;
         }
         // Start listening for incoming messages
         t_ = new std::thread(&KVStore::monitor_sockets_, this);
+        if (!is_server()) {
+            exit_if_not(connection_to_(0) >= 0, "Could not connect to the lead node");
+            p("Node ", idx_).p(idx_, idx_).pln(": Connection to lead node succeeded.", idx_);
+        }
     }
 
     /**
      * Shutdown protocol.
-     * Closes all sockets and deletes all fields.
+     * Wakes up every waiting thread and tells the event loop to stop. The event loop closes all
+     * of the sockets on its way out.
      */
     void shutdown() {
+        // Let every thread waiting for credits through, to find out that the node is shutting down
+        for (size_t i = 0; i < num_nodes_; i++) flow_[i].close();
+        // Wake up every thread waiting on a reply so that it can exit
+        pending_mtx_.lock();
+        if (has_shutdown) {
+            pending_mtx_.unlock();
+            return;
+        }
         has_shutdown = true;
-        if (is_server()) {
-            delete directory_;
-        } else {
-            close(servfd_);
+        for (std::unordered_map<size_t, PendingRequest*>::iterator it = pending_.begin();
+            it != pending_.end(); it++) {
+            it->second->cv_.notify_one();
         }
-        clear_map_();
-        close(fd_);
-        delete[] ip_;
-        delete[] buffer_;
-        delete[] nodes_;
+        pending_mtx_.unlock();
+        // Wake up every thread waiting on the address of another node
+        nodes_mtx_.lock();
+        nodes_mtx_.unlock();
+        nodes_cv_.notify_all();
+        // Wake up the thread waiting in a barrier or collective operation
+        inbox_mtx_.lock();
+        inbox_mtx_.unlock();
+        inbox_cv_.notify_all();
+        // Wake up every thread waiting on a key
+        for (size_t j = 0; j < map_.shards(); j++) {
+            map_.locks_[j].lock();
+            for (std::unordered_map<std::string, KeyWatchers*>::iterator it = watchers_[j].begin();
+                it != watchers_[j].end(); it++) {
+                it->second->cv_.notify_all();
+            }
+            map_.locks_[j].unlock();
+        }
+        uint64_t one = 1;
+        exit_if_not(write(wake_fd_, &one, sizeof(one)) == sizeof(one), "Call to write() failed");
     }
 
     /**
      * Send a message to a specific node.
      * 
-     * @param msg The message to be sent
-     * @param dst The index of the destination node
+     * @param msg  The message to be sent
+     * @param dst  The index of the destination node
+     * @param blob The value carried by the message, or nullptr if it carries none
+     */
+    void send_to_node_(const char* msg, size_t dst, const char* blob = nullptr) {
+        send_to_node_(msg, dst, &blob, blob == nullptr ? 0 : 1);
+    }
+
+    /**
+     * Send a message that carries the given values to a specific node. Once this node has shut
+     * down, for example because another node went away first, the message is dropped.
      */
-    void send_to_node_(const char* msg, size_t dst) {
+    void send_to_node_(const char* msg, size_t dst, const char** blobs, size_t n) {
         exit_if_not(dst < num_nodes_, "Invalid dst node index");
-        int fd = nodes_[dst];
-        while (fd == -1) {
-            // Wait indefinitely until the desired node is available
-            sleep(1);
-            p("Node ", idx_).p(idx_, idx_).p(": Could not find a node with index ", idx_)
-                .pln(dst, idx_);
-            fd = nodes_[dst];
-            if (has_shutdown) exit(-1);
+        int fd = connection_to_(dst);
+        if (fd < 0 && has_shutdown) return;
+        exit_if_not(fd >= 0, "Could not connect to the destination node");
+        send_all_(fd, msg, blobs, n);
+    }
+
+    /**
+     * Returns the socket to the given node, connecting to it first if this is the first message
+     * for it. A new connection starts with a Register message so that the other node knows who
+     * is on the other end. If the node's address is not known yet, waits for the Directory that
+     * names it; if the node is not listening yet, retries with a growing backoff.
+     *
+     * @return The socket fd, or -1 if this node shut down first
+     */
+    int connection_to_(size_t dst) {
+        std::unique_lock<std::mutex> lk(nodes_mtx_);
+        if (nodes_[dst] >= 0) return nodes_[dst];
+        while (!members_->known(dst) && !has_shutdown) nodes_cv_.wait(lk);
+        if (has_shutdown) return -1;
+        char* host = duplicate(members_->host(dst));
+        char* port = duplicate(members_->port(dst));
+        lk.unlock();
+        // Connect without holding the lock, since the other node may not be up yet
+        Transport* t = transport_for_(host);
+        int fd = t->connect_to(host, port);
+        useconds_t backoff = 1000;
+        while (fd < 0 && !has_shutdown) {
+            usleep(backoff);
+            backoff = std::min(backoff * 2, (useconds_t)1000000);
+            fd = t->connect_to(host, port);
+        }
+        delete[] host; delete[] port;
+        if (fd < 0) return -1;
+        add_connection_(fd, t);
+        get_connection_(fd)->node_ = dst;
+        lk.lock();
+        char* addr = members_->address(idx_);
+        Register reg(new String(addr), idx_);
+        delete[] addr;
+        const char* msg = reg.serialize();
+        send_all_(fd, msg);
+        delete[] msg;
+        // If the other node connected to this one in the meantime, both sockets stay open and
+        // either one can carry requests
+        if (nodes_[dst] < 0) nodes_[dst] = fd;
+        return nodes_[dst];
+    }
+
+    /**
+     * Sends the given serialized message over the given socket, framed by a header holding its
+     * length. The value the message carries, if any, is sent straight from the given buffer
+     * rather than being copied into the message first. Holds the connection's send lock so that
+     * messages sent by different threads are never interleaved.
+     */
+    void send_all_(int fd, const char* msg, const char* blob = nullptr) {
+        send_all_(fd, msg, &blob, blob == nullptr ? 0 : 1);
+    }
+
+    /**
+     * Sends the given serialized message over the given socket, followed by each of the given
+     * values back to back, all straight from their own buffers.
+     */
+    void send_all_(int fd, const char* msg, const char** blobs, size_t n) {
+        Connection* c = get_connection_(fd);
+        size_t meta_len = strlen(msg);
+        struct iovec* iov = new struct iovec[n + 2];
+        size_t blob_len = 0;
+        // Every value goes out with its terminator, so that the receiver can use each of several
+        // values in place, in the buffer that it reads them all into
+        for (size_t i = 0; i < n; i++) {
+            iov[i + 2].iov_base = (void*)blobs[i];
+            iov[i + 2].iov_len = strlen(blobs[i]) + 1;
+            blob_len += iov[i + 2].iov_len;
         }
-        exit_if_not(send(fd, msg, strlen(msg) + 1, 0) > 0, "Sending msg to other client failed");
+        exit_if_not(meta_len <= cfg_.max_frame_bytes_ && blob_len <= cfg_.max_frame_bytes_,
+            "A message is larger than KVConfig::max_frame_bytes_");
+        FrameHeader hdr(meta_len, blob_len);
+        iov[0].iov_base = hdr.bytes_;
+        iov[0].iov_len = FRAME_HEADER_SIZE;
+        iov[1].iov_base = (void*)msg;
+        iov[1].iov_len = meta_len;
+        // A transport that stands in for a slower network holds the message back for its
+        // latency, and then keeps the connection busy for as long as the bytes take to send
+        size_t wait_us = c->transport_->latency_us(idx_, c->node_, c->sent_++);
+        if (wait_us > 0) usleep(wait_us);
+        c->send_mtx_.lock();
+        size_t busy_us = c->transport_->transmit_us(FRAME_HEADER_SIZE + meta_len + blob_len);
+        if (busy_us > 0) usleep(busy_us);
+        bool sent = send_iov_(fd, iov, n + 2);
+        c->send_mtx_.unlock();
+        // The other node closed the connection, which means the same as it does to the event loop
+        if (!sent) shutdown();
+        stats_.sent(kind_of_(msg), c->node_, FRAME_HEADER_SIZE + meta_len + blob_len);
+        delete[] iov;
     }
 
     /**
-     * Listens for incoming messages coming from other nodes on the network and then processes them
-     * accordingly.
+     * Writes every byte of the given buffers to the given socket, in order. The caller must hold
+     * the connection's send lock. The iovecs are advanced in place as bytes go out.
+     *
+     * @return false if the other node hung up first
+     */
+    bool send_iov_(int fd, struct iovec* iov, int cnt) {
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        while (cnt > 0) {
+            mh.msg_iov = iov;
+            mh.msg_iovlen = std::min(cnt, IOV_MAX);
+            ssize_t n = sendmsg(fd, &mh, MSG_NOSIGNAL);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // The socket's send buffer is full, so wait until it drains
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            // The other node hung up, for example because it is shutting down
+            if (n < 0 && (has_shutdown || errno == EPIPE || errno == ECONNRESET)) return false;
+            exit_if_not(n >= 0, "Call to sendmsg() failed");
+            // Skip past the buffers that were sent in full and into the one that was cut short
+            size_t sent = n;
+            while (cnt > 0 && sent >= iov->iov_len) {
+                sent -= iov->iov_len;
+                iov++;
+                cnt--;
+            }
+            if (cnt > 0) {
+                iov->iov_base = (char*)iov->iov_base + sent;
+                iov->iov_len -= sent;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Event loop. Waits on the epoll instance for new connections and incoming messages coming
+     * from other nodes on the network and then processes them accordingly. Every socket is
+     * registered edge-triggered, so each wakeup drains the socket it was for.
      */
     void monitor_sockets_() {
-        // length of other node's addrinfo struct
-        socklen_t addrlen;
-        // number of bytes read by recv()
-        int nbytes;
-        // The number of nodes on the network
-        int num_nodes = 1;
-        // The timeout argument for select()
-        struct timeval tv;
-        tv.tv_sec = 3;
-        tv.tv_usec = 0;
-        // Used to concat messages bigger than BUFSIZE
-        StrBuff buff;
-        // Clear the two fd lists
-        FD_ZERO(&master_);
-        FD_ZERO(&read_fds_);
-        // Start listening
-        exit_if_not(listen(fd_, BACKLOG) == 0, "Call to listen() failed");
-        // Add this Client's fd and the Server's to the master list and use them to initialize
-        // the max fd value
-        FD_SET(fd_, &master_);
-        if (is_server()) {
-            fdmax_ = fd_;
-        } else {
-            FD_SET(servfd_, &master_);
-            fdmax_ = fd_ > servfd_ ? fd_ : servfd_;
+        struct epoll_event events[MAX_EVENTS];
+        while (!has_shutdown) {
+            int n = epoll_wait(epfd_, events, MAX_EVENTS, -1);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) break;
+            for (int i = 0; i < n && !has_shutdown; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wake_fd_) {
+                    // shutdown() was called from another thread
+                    break;
+                } else if (fd == fd_) {
+                    accept_connections_(fd_, tcp_);
+                } else if (fd == local_fd_) {
+                    accept_connections_(local_fd_, unix_);
+                } else if (!read_connection_(get_connection_(fd))) {
+                    // Connection to the other node was closed or there was an error,
+                    // so shut down
+                    shutdown();
+                }
+            }
         }
-        // Main loop
+        close_connections_();
+    }
+
+    /**
+     * Accepts every pending connection on the given listening socket, which belongs to the given
+     * transport, and adds them to the epoll set.
+     */
+    void accept_connections_(int listen_fd, Transport* t) {
         for (;;) {
-            read_fds_ = master_; // Copy the master list
-            // Select the existing socket connections and iterate through them
-            if (select(fdmax_ + 1, &read_fds_, NULL, NULL, &tv) < 0) return;
-            for (int i = 0; i <= fdmax_; i++) {
-                // In case shutdown() was called from the other thread
-                if (has_shutdown) return;
-                if (FD_ISSET(i, &read_fds_)) {
-                    if (i == fd_) {
-                        // Found a new connection
-                        if (num_nodes + 1 > BACKLOG) {
-                            // The network is full, do not accept this connection
-                            p("Node ", idx_).p(idx_, idx_)
-                                .pln(": Network is full, cannot accept new connection.", idx_);
-                            continue;
-                        }
-                        num_nodes++;
-                        // The node is receiving a new connection from another one
-                        addrlen = sizeof(their_addr_);
-                        // Accept the connection and add the new socket fd to the master list
-                        exit_if_not((their_fd_ = accept(fd_, (struct sockaddr*)&their_addr_, &addrlen)) >= 0, 
-                            "Call to accept() failed");
-                        FD_SET(their_fd_, &master_);
-                        // Update the max fd value
-                        if (their_fd_ > fdmax_) {
-                            fdmax_ = their_fd_;
-                        }
-                    } else {
-                        // Receiving a message
-                        if ((nbytes = recv(i, buffer_, BUF_SIZE, 0)) <= 0) {
-                            // Connection to the other node was closed or there was an error,
-                            // so shut down
-                            shutdown();
-                            return;
-                        } else {
-                            buff.c(buffer_, nbytes);
-                            // Serialized messages are terminated with newlines, so if the buffer
-                            // does not end with a newline, the message was chunked
-                            if (buffer_[nbytes - 2] != '\n') continue;
-                            // Figure out what kind of message was received
-                            char* serial_msg = buff.c_str();
-                            Deserializer ds(serial_msg);
-                            Message* m = ds.deserialize_message();
-                            assert(m != nullptr);
-                            switch (m->kind()) {
-                                case MsgKind::Directory: process_directory_(m->as_directory()); break;
-                                case MsgKind::Register: process_register_(m->as_register(), i); break;
-                                case MsgKind::Reply: process_reply_(m->as_reply()); break;
-                                case MsgKind::Ack: {
-                                    // Set the value that put() is waiting for above
-                                    ack_recvd_ = true;
-                                    delete m;
-                                    break;
-                                }
-                                case MsgKind::Put:
-                                    threads_->push_back(std::thread(&KVStore::process_put_, this, m->as_put(), i));
-                                    break;
-                                case MsgKind::Get:
-                                    threads_->push_back(std::thread(&KVStore::process_get_, this, m->as_get(), i));
-                                    break;
-                                case MsgKind::WaitAndGet:
-                                    threads_->push_back(std::thread(&KVStore::process_wag_, this, m->as_wait_and_get(), i));
-                                    break;
-                                default: shutdown();
-                            }
-                            delete[] serial_msg;
-                        }
-                    }
+            int fd = t->accept_on(listen_fd);
+            if (fd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (fd < 0 && errno == EINTR) continue;
+            exit_if_not(fd >= 0, "Call to accept() failed");
+            add_connection_(fd, t);
+        }
+    }
+
+    /**
+     * Reads everything that is available on the given connection and processes each message that
+     * is now complete. Once a message's header has arrived its meta and value are allocated at
+     * their exact sizes, and whenever a large part of either is still missing it is read straight
+     * into place rather than through the shared buffer.
+     * 
+     * @return false if the other node closed the connection or there was an error
+     */
+    bool read_connection_(Connection* c) {
+        for (;;) {
+            ssize_t nbytes;
+            size_t room = 0;
+            char* dst = c->in_body_ ? c->next(&room) : nullptr;
+            if (room >= BUF_SIZE) {
+                nbytes = recv(c->fd_, dst, room, 0);
+                if (nbytes > 0) {
+                    c->got_ += nbytes;
+                    if (c->complete()) finish_frame_(c);
+                    continue;
+                }
+            } else {
+                nbytes = recv(c->fd_, buffer_, BUF_SIZE, 0);
+                if (nbytes > 0) {
+                    if (!consume_(c, buffer_, nbytes)) return false;
+                    continue;
+                }
+            }
+            if (nbytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (nbytes < 0 && errno == EINTR) continue;
+            return false;
+        }
+    }
+
+    /**
+     * Splits the given bytes read from the given connection into message headers and bodies.
+     * One read can hold several messages or only part of one, so whatever is left over stays in
+     * the connection until the rest arrives.
+     *
+     * @return false if a header announced a part larger than KVConfig::max_frame_bytes_
+     */
+    bool consume_(Connection* c, const char* data, size_t len) {
+        while (len > 0) {
+            if (!c->in_body_) {
+                size_t n = std::min(len, FRAME_HEADER_SIZE - c->hdr_got_);
+                memcpy(c->hdr_ + c->hdr_got_, data, n);
+                c->hdr_got_ += n;
+                data += n;
+                len -= n;
+                if (c->hdr_got_ < FRAME_HEADER_SIZE) return true;
+                c->meta_len_ = FrameHeader::meta_len(c->hdr_);
+                c->blob_len_ = FrameHeader::blob_len(c->hdr_);
+                if (c->meta_len_ > cfg_.max_frame_bytes_ || c->blob_len_ > cfg_.max_frame_bytes_) {
+                    // The stream is corrupt, so nothing after this header can be trusted either
+                    p("Node ", idx_).p(idx_, idx_)
+                        .pln(": Refused a message larger than KVConfig::max_frame_bytes_", idx_);
+                    return false;
                 }
+                // Leave room to null-terminate both parts for the Deserializer
+                c->meta_ = new char[c->meta_len_ + 1];
+                if (c->blob_len_ > 0) c->blob_ = new char[c->blob_len_ + 1];
+                c->got_ = 0;
+                c->in_body_ = true;
+            } else {
+                size_t room;
+                char* dst = c->next(&room);
+                size_t n = std::min(len, room);
+                memcpy(dst, data, n);
+                c->got_ += n;
+                data += n;
+                len -= n;
             }
+            if (c->complete()) finish_frame_(c);
         }
+        return true;
+    }
+
+    /**
+     * Processes the message that the given connection just finished reading and gets the
+     * connection ready to read the next header.
+     */
+    void finish_frame_(Connection* c) {
+        char* meta = c->meta_;
+        char* blob = c->blob_;
+        meta[c->meta_len_] = '\0';
+        stats_.received(kind_of_(meta), c->node_,
+            FRAME_HEADER_SIZE + c->meta_len_ + c->blob_len_);
+        if (blob != nullptr) blob[c->blob_len_] = '\0';
+        c->meta_ = nullptr;
+        c->blob_ = nullptr;
+        c->hdr_got_ = 0;
+        c->in_body_ = false;
+        c->meta_len_ = 0;
+        c->blob_len_ = 0;
+        c->got_ = 0;
+        process_message_(meta, blob, c->fd_);
+        delete[] meta;
+    }
+
+    /**
+     * Returns the kind of the given serialized message, which is always its first field.
+     */
+    size_t kind_of_(const char* msg) {
+        return strtoul(msg + 1, nullptr, 10);
+    }
+
+    /**
+     * Deserializes the given message that was received over the given socket and processes it
+     * according to its kind. Takes ownership of the value that was received with it, if any,
+     * which the resulting Put or Reply carries on without a copy.
+     */
+    void process_message_(const char* serial_msg, char* blob, int fd) {
+        Deserializer ds(serial_msg, blob);
+        Message* m = ds.deserialize_message();
+        assert(m != nullptr);
+        switch (m->kind()) {
+            case MsgKind::Directory: process_directory_(m->as_directory()); break;
+            case MsgKind::Register: process_register_(m->as_register(), fd); break;
+            case MsgKind::Reply: process_reply_(m->as_reply()); break;
+            case MsgKind::Ack: {
+                // Wake up the put() that is waiting for this Ack
+                complete_request_(m->as_ack()->get_id(), nullptr);
+                delete m;
+                break;
+            }
+            case MsgKind::Put:
+                pool_->submit(std::bind(&KVStore::process_put_, this, m->as_put(), fd));
+                break;
+            case MsgKind::Get:
+                pool_->submit(std::bind(&KVStore::process_get_, this, m->as_get(), fd));
+                break;
+            case MsgKind::WaitAndGet:
+                pool_->submit(std::bind(&KVStore::process_wag_, this, m->as_wait_and_get(), fd));
+                break;
+            case MsgKind::MultiPut:
+                pool_->submit(std::bind(&KVStore::process_multi_put_, this, m->as_multi_put(),
+                    fd));
+                break;
+            case MsgKind::MultiGet:
+                pool_->submit(std::bind(&KVStore::process_multi_get_, this, m->as_multi_get(),
+                    fd));
+                break;
+            case MsgKind::MultiReply: {
+                MultiReply* mr = m->as_multi_reply();
+                size_t bytes = 0;
+                for (size_t i = 0; i < mr->size(); i++) bytes += mr->blobs_[i].size();
+                complete_request_(mr->get_id(), nullptr, mr->steal_blobs(), bytes);
+                delete mr;
+                break;
+            }
+            case MsgKind::Barrier: process_barrier_(m->as_barrier()); break;
+            case MsgKind::Collective: process_collective_(m->as_collective()); break;
+            case MsgKind::Stats:
+                pool_->submit(std::bind(&KVStore::process_stats_, this, m->as_stats(), fd));
+                break;
+            default: shutdown();
+        }
+    }
+
+    /**
+     * Makes the given socket non-blocking, which the edge-triggered event loop relies on.
+     */
+    void set_nonblocking_(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        exit_if_not(flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0,
+            "Call to fcntl() failed");
+    }
+
+    /**
+     * Registers the given fd with the epoll instance, edge-triggered.
+     */
+    void watch_fd_(int fd) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = fd;
+        exit_if_not(epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0, "Call to epoll_ctl() failed");
+    }
+
+    /**
+     * Starts tracking a newly opened socket to another node: gives it its own read buffer, makes
+     * it non-blocking, lets the transport it came from set its options, and adds it to the epoll
+     * set.
+     */
+    void add_connection_(int fd, Transport* t) {
+        set_nonblocking_(fd);
+        t->tune(fd);
+        conns_mtx_.lock();
+        conns_[fd] = new Connection(fd, t);
+        conns_mtx_.unlock();
+        watch_fd_(fd);
+    }
+
+    /**
+     * Returns the connection for the given socket fd.
+     */
+    Connection* get_connection_(int fd) {
+        std::lock_guard<std::mutex> lk(conns_mtx_);
+        std::unordered_map<int, Connection*>::iterator it = conns_.find(fd);
+        exit_if_not(it != conns_.end(), "No connection for the given socket");
+        return it->second;
     }
 
     /**
@@ -453,12 +1669,15 @@ public:
      * @param directory The directory
      */
     void process_directory_(Directory* directory) {
-        Vector* ips = directory->get_addresses();
+        Vector* addrs = directory->get_addresses();
         IntVector* indices = directory->get_indices();
-        for (int i = 0; i < ips->size(); i++) {
-            char* ip = ips->get(i)->c_str();
-            if (strcmp(ip, ip_) != 0) connect_to_client_(ip, indices->get(i));
+        nodes_mtx_.lock();
+        for (int i = 0; i < addrs->size(); i++) {
+            size_t idx = indices->get(i);
+            if (!members_->known(idx)) members_->set(idx, addrs->get(i)->c_str());
         }
+        nodes_mtx_.unlock();
+        nodes_cv_.notify_all();
         delete directory;
     }
 
@@ -466,31 +1685,68 @@ public:
      * Process the given Register message sent by another node wanting to connect with this one.
      */
     void process_register_(Register* reg, int fd) {
-        char* new_ip = reg->get_ip()->c_str();
         size_t new_idx = reg->get_sender();
+        exit_if_not(new_idx < num_nodes_, "Register was sent by an invalid node");
+        nodes_mtx_.lock();
+        // Keep track of the sender's address and socket fd
+        if (!members_->known(new_idx)) members_->set(new_idx, reg->get_ip()->c_str());
+        if (nodes_[new_idx] < 0) nodes_[new_idx] = fd;
+        nodes_mtx_.unlock();
+        get_connection_(fd)->node_ = new_idx;
+        nodes_cv_.notify_all();
         if (is_server()) {
-            // A client is registering with the server
-            // Add the new IP to the directory
-            directory_->add_client(new_ip, new_idx);
-            // Send the updated directory back to the client
+            // A client is registering with the server, so send every client the updated
+            // directory, including the new one
+            directory_->clear();
+            std::vector<int> fds;
+            nodes_mtx_.lock();
+            for (size_t i = 1; i < num_nodes_; i++) {
+                if (!members_->known(i)) continue;
+                char* addr = members_->address(i);
+                directory_->add_client(addr, i);
+                delete[] addr;
+                if (nodes_[i] >= 0) fds.push_back(nodes_[i]);
+            }
+            nodes_mtx_.unlock();
             const char* serial_directory = directory_->serialize();
-            exit_if_not(send(fd, serial_directory, strlen(serial_directory) + 1, 0) > 0,
-                "Call to send() failed");
+            for (size_t i = 0; i < fds.size(); i++) send_all_(fds[i], serial_directory);
             delete[] serial_directory;
         }
-        // Keep track of the sender's socket fd and node index
-        nodes_[new_idx] = fd;
         delete reg;
     }
 
+    /**
+     * Process the given Barrier message by putting it in the inbox, for the barrier() that waits
+     * on its sender.
+     */
+    void process_barrier_(Barrier* b) {
+        deliver_(b->get_epoch(), b->get_sender(), Blob());
+        delete b;
+    }
+
+    /**
+     * Process the given Collective message by putting its value in the inbox, for the step of a
+     * collective operation that waits on its sender.
+     */
+    void process_collective_(Collective* c) {
+        deliver_(c->get_epoch(), c->get_sender(), Blob(c->get_value()));
+        delete c;
+    }
+
+    /** Puts the given value from the given node in the inbox and wakes up the waiting thread. */
+    void deliver_(size_t epoch, size_t sender, Blob v) {
+        inbox_mtx_.lock();
+        inbox_[std::make_pair(epoch, sender)] = v;
+        inbox_mtx_.unlock();
+        inbox_cv_.notify_all();
+    }
+
+    /**
+     * Process the given Reply by handing its data to the get() or wait_and_get() waiting on it.
+     */
     void process_reply_(Reply* rep) {
-        MsgKind req = rep->get_request();
         const char* v = rep->get_value();
-        // Set the values that get() and wait_and_get() wait for above
-        if (req == MsgKind::WaitAndGet)
-            wag_reply_data_ = v;
-        else
-            reply_data_ = v;
+        complete_request_(rep->get_id(), v, nullptr, v == nullptr ? 0 : strlen(v));
         delete rep;
     }
 
@@ -505,107 +1761,131 @@ public:
         const char* v = p->get_value();
         // Ensure that this message was sent to the right node
         exit_if_not(k->get_home_node() == idx_, "Put was sent to incorrect node");
-        put(*k, v);
+        store_local_(*k, v);
 
         // Reply with an Ack confirming that the put operation was successful
-        Ack* a = new Ack();
+        Ack* a = new Ack(p->get_id());
         const char* msg = a->serialize();
-        exit_if_not(send(fd, msg, strlen(msg) + 1, 0) > 0, "Call to send() failed");
+        send_all_(fd, msg);
         delete p; delete k; delete a; delete[] msg;
     }
 
     /**
-     * Starts the get operation in a separate thread
+     * Stores every value in the given MultiPut and replies with a single Ack.
+     */
+    void process_multi_put_(MultiPut* mp, int fd) {
+        for (size_t i = 0; i < mp->size(); i++) {
+            Key* k = mp->get_key(i);
+            exit_if_not(k->get_home_node() == idx_, "MultiPut was sent to incorrect node");
+            store_local_(*k, mp->get_blob(i));
+            delete k;
+        }
+        Ack a(mp->get_id());
+        const char* msg = a.serialize();
+        send_all_(fd, msg);
+        delete mp; delete[] msg;
+    }
+
+    /**
+     * Looks up every key in the given MultiGet and sends all of the data back in one MultiReply.
+     */
+    void process_multi_get_(MultiGet* mg, int fd) {
+        size_t n = mg->size();
+        // The handles keep the values alive while they are sent
+        Blob* blobs = new Blob[n];
+        const char** values = new const char*[n];
+        for (size_t i = 0; i < n; i++) {
+            Key* k = mg->get_key(i);
+            exit_if_not(k->get_home_node() == idx_, "MultiGet was sent to incorrect node");
+            blobs[i] = serve_stored_(*k);
+            values[i] = blobs[i].c_str();
+            delete k;
+        }
+        MultiReply r(values, n, mg->get_id());
+        const char* msg = r.serialize_meta();
+        send_all_(fd, msg, values, n);
+        delete mg; delete[] msg; delete[] blobs;
+    }
+
+    /**
+     * Handles a Get on one of the pool's worker threads
      */
     void process_get_(Get* g, int fd) {
         Key* k = g->get_key();
         // Ensure that this message was sent to the right node
         exit_if_not(k->get_home_node() == idx_, "Put was sent to incorrect node");
-        const char* res = get(*k);
+        Blob res = serve_stored_(*k);
 
         // Send back a Reply with the data
-        Reply r(res, MsgKind::Get);
-        const char* msg = r.serialize();
-        exit_if_not(send(fd, msg, strlen(msg) + 1, 0) > 0, "Call to send() failed");
-        delete g; delete k; delete[] msg; delete[] res;
+        Reply r(res.c_str(), MsgKind::Get, g->get_id());
+        const char* msg = r.serialize_meta();
+        send_all_(fd, msg, res.c_str());
+        delete g; delete k; delete[] msg;
     }
 
     /**
-     * Starts the wait_and_get operation in a separate thread
+     * Handles a WaitAndGet on one of the pool's worker threads. If the key has not been put yet,
+     * the request is added to the key's watchers instead of tying up the worker, and the put
+     * that stores the key replies to it.
      */
     void process_wag_(WaitAndGet* wag, int fd) {
         Key* k = wag->get_key();
         // Ensure that this message was sent to the right node
         exit_if_not(k->get_home_node() == idx_, "Put was sent to incorrect node");
-        const char* res = wait_and_get(*k);
+        RWLock& lock = map_.lock_for(*k->get_keystring());
+        lock.lock();
+        if (!map_.contains_locked(*k->get_keystring())) {
+            watchers_for_(k->get_keystring())->remote_.push_back(std::make_pair(wag, fd));
+            lock.unlock();
+            return;
+        }
+        lock.unlock();
+        Blob res = serve_stored_(*k);
 
         // Send back a Reply with the data
-        Reply r(res, MsgKind::WaitAndGet);
-        const char* msg = r.serialize();
-        exit_if_not(send(fd, msg, strlen(msg) + 1, 0) > 0, "Call to send() failed");
-        delete wag; delete k; delete[] msg; delete[] res;
+        Reply r(res.c_str(), MsgKind::WaitAndGet, wag->get_id());
+        const char* msg = r.serialize_meta();
+        send_all_(fd, msg, res.c_str());
+        delete wag; delete k; delete[] msg;
     }
 
     /**
-     * Client function
-     * Create a socket to the client at the given IP, connect to it, and send it a Register message.
-     * 
-     * @param ip  The IP address of the other client
-     * @param idx The node index of the other client
-     */
-    void connect_to_client_(char* ip, size_t idx) {
-        struct addrinfo* client_info;
-        int client_fd;
-        // Generate an addrinfo struct for the other client
-        memset(&hints_, 0, sizeof(hints_));
-        hints_.ai_family = AF_INET;
-        hints_.ai_socktype = SOCK_STREAM;
-        exit_if_not(getaddrinfo(ip, PORT, &hints_, &client_info) == 0, 
-            "Call to getaddrinfo() failed");
-        // Create a socket to connect to the client
-        exit_if_not((client_fd = socket(client_info->ai_family, client_info->ai_socktype, 
-            client_info->ai_protocol)) >= 0, "Call to socket() failed");
-        // Connect to the client
-        exit_if_not(connect(client_fd, client_info->ai_addr, client_info->ai_addrlen) >= 0, 
-            "Call to connect() failed");
-        freeaddrinfo(client_info);
-        // Send the client a Register message
-        Register reg(new String(ip_), idx_);
-        const char* msg = reg.serialize();
-        exit_if_not(send(client_fd, msg, strlen(msg) + 1, 0) > 0, 
-            "Sending Register to other client failed");
-        // Add the fd to the master list
-        FD_SET(client_fd, &master_);
-        // Update the max fd value
-        if (client_fd > fdmax_) {
-            fdmax_ = client_fd;
-        }
-        // Keep track of the client's fd and node index
-        nodes_[idx] = client_fd;
-        delete[] msg;
+     * Answers the given Stats request with this node's report.
+     */
+    void process_stats_(Stats* st, int fd) {
+        char* report = report_();
+        Reply r(report, MsgKind::Stats, st->get_id());
+        const char* msg = r.serialize_meta();
+        send_all_(fd, msg, report);
+        delete st; delete[] msg; delete[] report;
     }
 
     /**
-     * Empties the fd/ip map and closes every fd
+     * Closes every socket and empties the fd/idx map. Only called by the event loop on its way
+     * out, so no other thread is reading from these sockets.
      */
-    void clear_map_() {
-        for (int i = 0; i < BACKLOG; i++) {
-            int fd = nodes_[i];
-            if (fd != -1) {
-                close(fd);
-                nodes_[i] = -1;
-            }
+    void close_connections_() {
+        conns_mtx_.lock();
+        for (std::unordered_map<int, Connection*>::iterator it = conns_.begin();
+            it != conns_.end(); it++) {
+            close(it->first);
         }
+        conns_mtx_.unlock();
+        nodes_mtx_.lock();
+        for (int i = 0; i < num_nodes_; i++) nodes_[i] = -1;
+        nodes_mtx_.unlock();
+        if (fd_ >= 0) tcp_->close_listener(fd_);
+        if (local_fd_ >= 0) unix_->close_listener(local_fd_);
     }
 
     /**
-     * The IP address of a node is 127.0.0.x where x is the node index + 1.
-     * So given a node index, this function returns the corresponding IP address.
+     * Returns the transport to use for the node on the given host: the in-process loopback if
+     * this is an in-process cluster, a Unix socket if it is this host and those are turned on,
+     * and otherwise TCP.
      */
-    char* idx_to_ip_(size_t idx) {
-        char* ip = new char[INET_ADDRSTRLEN + 1];
-        int bytes = sprintf(ip, "127.0.0.%zu", idx + 1);
-        exit_if_not(bytes <= INET_ADDRSTRLEN + 1, "Invalid index");
-        return ip;
+    Transport* transport_for_(const char* host) {
+        if (cfg_.loopback_) return unix_;
+        if (unix_ != nullptr && is_local_address(host)) return unix_;
+        return tcp_;
     }
 };
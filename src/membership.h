@@ -0,0 +1,127 @@
+//lang::Cpp
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include "object.h"
+
+// The port that nodes listen on when their address does not name one
+#define DEFAULT_PORT "8080"
+// The longest line allowed in a membership file
+#define MEMBERSHIP_LINE_MAX 512
+
+/**
+ * The address (host and port) of every node in the cluster, by node index. An address may be
+ * unknown until another node tells this one about it.
+ *
+ * Membership files have one node per line, written as its index and then its address, for
+ * example "3 10.0.0.7:9001". Blank lines and lines starting with '#' are skipped. The port may
+ * be left off, in which case it is DEFAULT_PORT.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Membership : public Object {
+public:
+    // The number of nodes in the cluster
+    size_t n_;
+    // The host of each node, or nullptr if it is unknown, owned
+    char** hosts_;
+    // The port of each node, or nullptr if it is unknown, owned
+    char** ports_;
+
+    /** Constructor for a cluster of the given size where no address is known yet */
+    Membership(size_t n) : n_(n) {
+        hosts_ = new char*[n_];
+        ports_ = new char*[n_];
+        for (size_t i = 0; i < n_; i++) hosts_[i] = ports_[i] = nullptr;
+    }
+
+    /** Destructor */
+    ~Membership() {
+        for (size_t i = 0; i < n_; i++) {
+            delete[] hosts_[i];
+            delete[] ports_[i];
+        }
+        delete[] hosts_;
+        delete[] ports_;
+    }
+
+    /**
+     * Returns the address that the given node has when nothing else says otherwise: node i
+     * listens on 127.0.0.(i + 1) at DEFAULT_PORT. The caller owns the result.
+     */
+    static char* default_address(size_t idx) {
+        char* addr = new char[32];
+        snprintf(addr, 32, "127.0.0.%zu:%s", idx + 1, DEFAULT_PORT);
+        return addr;
+    }
+
+    /**
+     * Reads the membership of a cluster of the given size from the file at the given path. Exits
+     * if the file cannot be read, has a malformed line, or leaves a node out.
+     */
+    static Membership* from_file(const char* path, size_t n) {
+        FILE* f = fopen(path, "r");
+        Sys s;
+        s.exit_if_not(f != nullptr, "Could not open the membership file");
+        Membership* m = new Membership(n);
+        char line[MEMBERSHIP_LINE_MAX];
+        char addr[MEMBERSHIP_LINE_MAX];
+        while (fgets(line, sizeof(line), f) != nullptr) {
+            size_t idx;
+            char* c = line;
+            while (*c == ' ' || *c == '\t') c++;
+            if (*c == '#' || *c == '\n' || *c == '\r' || *c == '\0') continue;
+            s.exit_if_not(sscanf(c, "%zu %511s", &idx, addr) == 2,
+                "Malformed line in the membership file");
+            s.exit_if_not(idx < n, "Node index in the membership file is out of range");
+            s.exit_if_not(!m->known(idx), "Node listed twice in the membership file");
+            m->set(idx, addr);
+        }
+        fclose(f);
+        for (size_t i = 0; i < n; i++)
+            s.exit_if_not(m->known(i), "Node missing from the membership file");
+        return m;
+    }
+
+    /** Returns the number of nodes in the cluster. */
+    size_t size() { return n_; }
+
+    /** Is the address of the given node known? */
+    bool known(size_t idx) { return idx < n_ && hosts_[idx] != nullptr; }
+
+    /** Returns the host of the given node, which must be known. */
+    const char* host(size_t idx) { return hosts_[idx]; }
+
+    /** Returns the port of the given node, which must be known. */
+    const char* port(size_t idx) { return ports_[idx]; }
+
+    /**
+     * Sets the address of the given node from a "host:port" or "host" string, replacing any
+     * address it already had.
+     */
+    void set(size_t idx, const char* addr) {
+        exit_if_not(idx < n_, "Invalid node index");
+        delete[] hosts_[idx];
+        delete[] ports_[idx];
+        const char* colon = strrchr(addr, ':');
+        const char* port = colon == nullptr ? DEFAULT_PORT : colon + 1;
+        size_t host_len = colon == nullptr ? strlen(addr) : colon - addr;
+        exit_if_not(host_len > 0 && *port != '\0', "Invalid node address");
+        hosts_[idx] = new char[host_len + 1];
+        memcpy(hosts_[idx], addr, host_len);
+        hosts_[idx][host_len] = '\0';
+        ports_[idx] = duplicate(port);
+    }
+
+    /** Returns the address of the given node as "host:port". The caller owns the result. */
+    char* address(size_t idx) {
+        exit_if_not(known(idx), "Address of node is unknown");
+        char* addr = new char[strlen(hosts_[idx]) + strlen(ports_[idx]) + 2];
+        sprintf(addr, "%s:%s", hosts_[idx], ports_[idx]);
+        return addr;
+    }
+};
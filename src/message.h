@@ -5,18 +5,80 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <endian.h>
+#include <stdint.h>
 #include "vector.h"
 #include "key.h"
+#include "blob.h"
+
+// The number of bytes in the header that precedes every serialized message on the wire
+#define FRAME_HEADER_SIZE 16
+
+/**
+ * The header that frames a serialized message on the wire. A message is sent as two parts: the
+ * serialized fields of the message (its meta), and for Puts and Replies, the blob of serialized
+ * data that they carry. The header holds the length of each part in bytes as a big-endian 64 bit
+ * integer, so that the receiver knows exactly how much to allocate for each one before it reads
+ * any of them, and so that the blob can be sent and received without being copied into or out of
+ * the meta.
+ * 
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class FrameHeader : public Object {
+public:
+    // The header as it is sent over the wire
+    char bytes_[FRAME_HEADER_SIZE];
+
+    /* Constructor for a header in front of a meta and a blob of the given lengths */
+    FrameHeader(size_t meta_len, size_t blob_len) {
+        uint64_t be = htobe64((uint64_t)meta_len);
+        memcpy(bytes_, &be, sizeof(be));
+        be = htobe64((uint64_t)blob_len);
+        memcpy(bytes_ + sizeof(be), &be, sizeof(be));
+    }
+
+    /* Returns the meta length held in the given header bytes that came off the wire */
+    static size_t meta_len(const char* bytes) {
+        uint64_t be;
+        memcpy(&be, bytes, sizeof(be));
+        return (size_t)be64toh(be);
+    }
+
+    /* Returns the blob length held in the given header bytes that came off the wire */
+    static size_t blob_len(const char* bytes) {
+        uint64_t be;
+        memcpy(&be, bytes + sizeof(be), sizeof(be));
+        return (size_t)be64toh(be);
+    }
+};
 
 /**
- * An enum for the different kinds of messages.
+ * An enum for the different kinds of messages. Count is not a kind of message: it stays last, so
+ * that it is the number of kinds.
  * 
  * @author Spencer LaChance <lachance.s@northeastern.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
-enum class MsgKind { Ack, Put, Reply, Get, WaitAndGet, Register, Directory };
+enum class MsgKind { Ack, Put, Reply, Get, WaitAndGet, Register, Directory, MultiPut, MultiGet,
+    MultiReply, Barrier, Stats, Collective, Count };
+
+// The number of kinds of message
+#define MSG_KINDS ((size_t)MsgKind::Count)
 
 class Ack; class Register; class Directory; class Reply; class Put; class Get; class WaitAndGet;
+class MultiPut; class MultiGet; class MultiReply; class Barrier; class Stats; class Collective;
+
+/**
+ * Returns the name of the message kind with the given number, for reports and logs.
+ */
+inline const char* kind_name(size_t kind) {
+    static const char* names[] = { "Ack", "Put", "Reply", "Get", "WaitAndGet", "Register",
+        "Directory", "MultiPut", "MultiGet", "MultiReply", "Barrier", "Stats", "Collective" };
+    static_assert(sizeof(names) / sizeof(names[0]) == MSG_KINDS, "Every MsgKind needs a name");
+    if (kind >= MSG_KINDS) return "Unknown";
+    return names[kind];
+}
  
 /**
  * An abstract class for messages
@@ -38,34 +100,78 @@ public:
     /* Returns this message's kind */
     MsgKind kind() { return kind_; }
 
-    /** Type converters: Return same column under its actual type, or
-     *  nullptr if of the wrong type.  */
-    virtual Ack* as_ack() = 0;
-    virtual Register* as_register() = 0;
-    virtual Directory* as_directory() = 0;
-    virtual Reply* as_reply() = 0;
-    virtual Put* as_put() = 0;
-    virtual Get* as_get() = 0;
-    virtual WaitAndGet* as_wait_and_get() = 0;
+    /** Type converters: Return same message under its actual type, or
+     *  nullptr if of the wrong type. Each subclass overrides its own. */
+    virtual Ack* as_ack() { return nullptr; }
+    virtual Register* as_register() { return nullptr; }
+    virtual Directory* as_directory() { return nullptr; }
+    virtual Reply* as_reply() { return nullptr; }
+    virtual Put* as_put() { return nullptr; }
+    virtual Get* as_get() { return nullptr; }
+    virtual WaitAndGet* as_wait_and_get() { return nullptr; }
+    virtual MultiPut* as_multi_put() { return nullptr; }
+    virtual MultiGet* as_multi_get() { return nullptr; }
+    virtual MultiReply* as_multi_reply() { return nullptr; }
+    virtual Barrier* as_barrier() { return nullptr; }
+    virtual Stats* as_stats() { return nullptr; }
+    virtual Collective* as_collective() { return nullptr; }
 };
+
+/**
+ * Appends the serialized form of each of the given keys to the given buffer.
+ */
+inline void serialize_keys(StrBuff& buff, Key** keys, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const char* serial_k = keys[i]->serialize();
+        buff.c(serial_k);
+        delete[] serial_k;
+    }
+}
+
+/**
+ * Appends the length of each of the given values to the given buffer, so that the receiver can
+ * split the values apart again after they are sent back to back.
+ */
+inline void serialize_lengths(StrBuff& buff, const char** values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const char* serial_len = Serializer::serialize_size_t(strlen(values[i]));
+        buff.c(serial_len);
+        delete[] serial_len;
+    }
+}
  
 
 class Ack : public Message {
 public:
+    // The ID of the Put request that this message acknowledges
+    size_t id_;
     
     /* Constructor. */
-    Ack() {
+    Ack(size_t id) : id_(id) {
         kind_ = MsgKind::Ack;
     }
 
+    /* Returns the ID of the request that this Ack answers */
+    size_t get_id() { return id_; }
+
+    bool equals(Object* other) {
+        Ack* o = dynamic_cast<Ack*>(other);
+        if (o == nullptr) return false;
+        return o->get_id() == id_;
+    }
+
     /* Returns a serialized representation of this acknowledge. */
     const char* serialize() {
         StrBuff buff;
         // serialize the MsgKind
         char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
         buff.c(serial_kind);
-        buff.c("\n");
         delete[] serial_kind;
+        // serialize the request ID
+        char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        buff.c("\n");
         return buff.c_str();
     }
 
@@ -315,9 +421,11 @@ class Put : public Message {
 public:
     Key* k_;   // external
     const char* v_; // external
+    // The ID that the sender uses to match the Ack to this request
+    size_t id_;
 
     /* Constructor */
-    Put(Key* k, const char* v) : k_(k), v_(v) {
+    Put(Key* k, const char* v, size_t id) : k_(k), v_(v), id_(id) {
         kind_ = MsgKind::Put;
     }
 
@@ -327,20 +435,39 @@ public:
     /* Returns this put message's value */
     const char* get_value() { return v_; }
 
-    /* Returns a serialized representation of this put message */
-    const char* serialize() {
+    /* Returns this put message's request ID */
+    size_t get_id() { return id_; }
+
+    /* Returns a serialized representation of this put message's fields, without the value */
+    const char* serialize_meta() {
         StrBuff buff;
         // serialize the MsgKind
         const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
         buff.c(serial_kind);
         delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
         // serialize the key
         const char* serial_k = k_->serialize();
         buff.c(serial_k);
         delete[] serial_k;
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /**
+     * Returns a serialized representation of this put message: its fields followed by the value.
+     * The KVStore sends the two parts separately instead, so that the value is never copied.
+     */
+    const char* serialize() {
+        StrBuff buff;
+        const char* meta = serialize_meta();
+        buff.c(meta);
+        delete[] meta;
         // write the serialized value
         buff.c(v_);
-        buff.c("\n");
         return buff.c_str();
     }
 
@@ -348,7 +475,8 @@ public:
     bool equals(Object* o) {
         Put* other = dynamic_cast<Put*>(o);
         if (other == nullptr) return false;
-        return other->get_key()->equals(k_) && strcmp(v_, other->get_value()) == 0;
+        return other->get_key()->equals(k_) && strcmp(v_, other->get_value()) == 0 &&
+            other->get_id() == id_;
     }
 
     /* Returns nullptr because this is not an Ack */
@@ -394,12 +522,18 @@ class Get : public Message {
 public:
     Key* k_;
 
+    // The ID that the sender uses to match the Reply to this request
+    size_t id_;
+
     /* Constructor, takes ownership of the given Key */
-    Get(Key* k) {
+    Get(Key* k, size_t id) : id_(id) {
         kind_ = MsgKind::Get;
         k_ = k;
     }
 
+    /* Returns this message's request ID */
+    size_t get_id() { return id_; }
+
     /* Return this Get message's key */
     Key* get_key() {
         return k_;
@@ -412,6 +546,10 @@ public:
         const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
         buff.c(serial_kind);
         delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
         // serialize the key
         const char* serialized_k = k_->serialize();
         buff.c(serialized_k);
@@ -424,7 +562,7 @@ public:
     bool equals(Object* o) {
         Get* other = dynamic_cast<Get*>(o);
         if (other == nullptr) return false;
-        return (other->get_key()->equals(k_));
+        return other->get_key()->equals(k_) && other->get_id() == id_;
     }
 
     /* Returns nullptr because this is not an Ack */
@@ -470,12 +608,18 @@ class WaitAndGet : public Message {
 public:
     Key* k_;
 
+    // The ID that the sender uses to match the Reply to this request
+    size_t id_;
+
     /* Constructor, takes ownership of the given Key */
-    WaitAndGet(Key* k) {
+    WaitAndGet(Key* k, size_t id) : id_(id) {
         kind_ = MsgKind::WaitAndGet;
         k_ = k;
     }
 
+    /* Returns this message's request ID */
+    size_t get_id() { return id_; }
+
     /* Desrtuctor */
     ~WaitAndGet() { }
 
@@ -491,6 +635,10 @@ public:
         const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
         buff.c(serial_kind);
         delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
         // serialize the key
         const char* serialized_k = k_->serialize();
         buff.c(serialized_k);
@@ -503,7 +651,7 @@ public:
     bool equals(Object* o) {
         WaitAndGet* other = dynamic_cast<WaitAndGet*>(o);
         if (other == nullptr) return false;
-        return (other->get_key()->equals(k_));
+        return other->get_key()->equals(k_) && other->get_id() == id_;
     }
 
     /* Returns nullptr because this is not an Ack */
@@ -550,12 +698,17 @@ public:
     const char* v_; // external
     // The type of request that this message is a response to (either Get or WaitAndGet)
     MsgKind request_;
+    // The ID of the request that this message is a response to
+    size_t id_;
 
     /* Constructor */
-    Reply(const char* v, MsgKind req) : v_(v), request_(req) {
+    Reply(const char* v, MsgKind req, size_t id) : v_(v), request_(req), id_(id) {
         kind_ = MsgKind::Reply;
     }
 
+    /* Return the ID of the request that this reply answers */
+    size_t get_id() { return id_; }
+
     /* Return this reply's value */
     const char* get_value() {
         return v_;
@@ -566,8 +719,8 @@ public:
         return request_;
     }
 
-    /* Returns a serialized representation of this reply message */
-    const char* serialize() {
+    /* Returns a serialized representation of this reply's fields, without the value */
+    const char* serialize_meta() {
         StrBuff buff;
         // serialize the MsgKind
         const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
@@ -577,9 +730,26 @@ public:
         const char* serial_req = Serializer::serialize_size_t((size_t)request_);
         buff.c(serial_req);
         delete[] serial_req;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /**
+     * Returns a serialized representation of this reply message: its fields followed by the
+     * value. The KVStore sends the two parts separately instead, so that the value is never
+     * copied.
+     */
+    const char* serialize() {
+        StrBuff buff;
+        const char* meta = serialize_meta();
+        buff.c(meta);
+        delete[] meta;
         // write the serialized value
         buff.c(v_);
-        buff.c("\n");
         return buff.c_str();
     }
 
@@ -587,7 +757,8 @@ public:
     bool equals(Object* o) {
         Reply* other = dynamic_cast<Reply*>(o);
         if (other == nullptr) return false;
-        return strcmp(v_, other->get_value()) == 0 && other->get_request() == request_;
+        return strcmp(v_, other->get_value()) == 0 && other->get_request() == request_ &&
+            other->get_id() == id_;
     }
 
     /* Returns nullptr because this is not an Ack */
@@ -624,4 +795,456 @@ public:
     WaitAndGet* as_wait_and_get() {
         return nullptr;
     }
-};
\ No newline at end of file
+};
+/**
+ * MultiPut is a Message subclass used to store several blobs of serialized data, all homed on the
+ * same node, with one round trip. The values travel back to back after the message's fields, each
+ * followed by its terminator, so that the receiver can hand out every value in place.
+ */
+class MultiPut : public Message {
+public:
+    Key** keys_;          // owned array, external keys
+    const char** values_; // owned array, external values
+    // The handles to the values of a received message, which share the buffer that they were
+    // received in, owned. nullptr for a message built to be sent
+    Blob* blobs_;
+    // The number of keys and values
+    size_t n_;
+    // The ID that the sender uses to match the Ack to this request
+    size_t id_;
+
+    /* Constructor, takes ownership of the two arrays but not of their contents */
+    MultiPut(Key** keys, const char** values, size_t n, size_t id) : keys_(keys), values_(values),
+        blobs_(nullptr), n_(n), id_(id) {
+        kind_ = MsgKind::MultiPut;
+    }
+
+    /* Constructor for a received message, takes ownership of the key array and of the handles */
+    MultiPut(Key** keys, Blob* blobs, size_t n, size_t id) : keys_(keys),
+        values_(new const char*[n]), blobs_(blobs), n_(n), id_(id) {
+        kind_ = MsgKind::MultiPut;
+        for (size_t i = 0; i < n_; i++) values_[i] = blobs_[i].c_str();
+    }
+
+    /* Destructor */
+    ~MultiPut() {
+        delete[] keys_;
+        delete[] values_;
+        delete[] blobs_;
+    }
+
+    /* Returns the number of keys in this message */
+    size_t size() { return n_; }
+
+    /* Returns the key at the given index */
+    Key* get_key(size_t i) { return keys_[i]; }
+
+    /* Returns the value at the given index */
+    const char* get_value(size_t i) { return values_[i]; }
+
+    /* Returns the array of values */
+    const char** get_values() { return values_; }
+
+    /* Returns the handle to the value at the given index of a received message */
+    Blob& get_blob(size_t i) { return blobs_[i]; }
+
+    /* Returns this message's request ID */
+    size_t get_id() { return id_; }
+
+    /* Returns a serialized representation of this message's fields, without the values */
+    const char* serialize_meta() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        // serialize the number of keys, the keys, and the length of each value
+        const char* serial_n = Serializer::serialize_size_t(n_);
+        buff.c(serial_n);
+        delete[] serial_n;
+        serialize_keys(buff, keys_, n_);
+        serialize_lengths(buff, values_, n_);
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Returns a serialized representation of this message: its fields followed by the values */
+    const char* serialize() {
+        StrBuff buff;
+        const char* meta = serialize_meta();
+        buff.c(meta);
+        delete[] meta;
+        for (size_t i = 0; i < n_; i++) buff.c(values_[i]);
+        return buff.c_str();
+    }
+
+    /* Return true if this message equals the given object, and false if not. */
+    bool equals(Object* o) {
+        MultiPut* other = dynamic_cast<MultiPut*>(o);
+        if (other == nullptr || other->size() != n_ || other->get_id() != id_) return false;
+        for (size_t i = 0; i < n_; i++) {
+            if (!other->get_key(i)->equals(keys_[i])) return false;
+            if (strcmp(other->get_value(i), values_[i]) != 0) return false;
+        }
+        return true;
+    }
+
+    /* Returns this MultiPut */
+    MultiPut* as_multi_put() {
+        return this;
+    }
+};
+
+/**
+ *  MultiGet is a Message subclass that is used to request several values, all homed on the same
+ *  node, with one round trip.
+ */
+class MultiGet : public Message {
+public:
+    Key** keys_; // owned array, external keys
+    // The number of keys
+    size_t n_;
+    // The ID that the sender uses to match the MultiReply to this request
+    size_t id_;
+
+    /* Constructor, takes ownership of the array but not of the keys */
+    MultiGet(Key** keys, size_t n, size_t id) : keys_(keys), n_(n), id_(id) {
+        kind_ = MsgKind::MultiGet;
+    }
+
+    /* Destructor */
+    ~MultiGet() {
+        delete[] keys_;
+    }
+
+    /* Returns the number of keys in this message */
+    size_t size() { return n_; }
+
+    /* Returns the key at the given index */
+    Key* get_key(size_t i) { return keys_[i]; }
+
+    /* Returns this message's request ID */
+    size_t get_id() { return id_; }
+
+    /* Returns a serialized representation of this message */
+    const char* serialize() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        // serialize the number of keys and the keys
+        const char* serial_n = Serializer::serialize_size_t(n_);
+        buff.c(serial_n);
+        delete[] serial_n;
+        serialize_keys(buff, keys_, n_);
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Return true if this message equals the given object, and false if not. */
+    bool equals(Object* o) {
+        MultiGet* other = dynamic_cast<MultiGet*>(o);
+        if (other == nullptr || other->size() != n_ || other->get_id() != id_) return false;
+        for (size_t i = 0; i < n_; i++) {
+            if (!other->get_key(i)->equals(keys_[i])) return false;
+        }
+        return true;
+    }
+
+    /* Returns this MultiGet */
+    MultiGet* as_multi_get() {
+        return this;
+    }
+};
+
+/**
+ * MultiReply is a Message subclass that answers a MultiGet with the requested values, in the
+ * order that their keys were requested in. Like a MultiPut's, the values travel back to back,
+ * each followed by its terminator.
+ */
+class MultiReply : public Message {
+public:
+    const char** values_; // owned array, external values
+    // The handles to the values of a received message, which share the buffer that they were
+    // received in, owned. nullptr for a message built to be sent
+    Blob* blobs_;
+    // The number of values
+    size_t n_;
+    // The ID of the MultiGet that this message answers
+    size_t id_;
+
+    /* Constructor, takes ownership of the array but not of the values */
+    MultiReply(const char** values, size_t n, size_t id) : values_(values), blobs_(nullptr),
+        n_(n), id_(id) {
+        kind_ = MsgKind::MultiReply;
+    }
+
+    /* Constructor for a received message, takes ownership of the handles */
+    MultiReply(Blob* blobs, size_t n, size_t id) : values_(new const char*[n]), blobs_(blobs),
+        n_(n), id_(id) {
+        kind_ = MsgKind::MultiReply;
+        for (size_t i = 0; i < n_; i++) values_[i] = blobs_[i].c_str();
+    }
+
+    /* Destructor */
+    ~MultiReply() {
+        delete[] values_;
+        delete[] blobs_;
+    }
+
+    /* Returns the number of values in this message */
+    size_t size() { return n_; }
+
+    /* Returns the value at the given index */
+    const char* get_value(size_t i) { return values_[i]; }
+
+    /* Returns the array of values */
+    const char** get_values() { return values_; }
+
+    /* Hands the handles to the values of a received message to the caller, who then owns them */
+    Blob* steal_blobs() {
+        Blob* res = blobs_;
+        blobs_ = nullptr;
+        return res;
+    }
+
+    /* Return the ID of the request that this reply answers */
+    size_t get_id() { return id_; }
+
+    /* Returns a serialized representation of this message's fields, without the values */
+    const char* serialize_meta() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        // serialize the number of values and the length of each one
+        const char* serial_n = Serializer::serialize_size_t(n_);
+        buff.c(serial_n);
+        delete[] serial_n;
+        serialize_lengths(buff, values_, n_);
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Returns a serialized representation of this message: its fields followed by the values */
+    const char* serialize() {
+        StrBuff buff;
+        const char* meta = serialize_meta();
+        buff.c(meta);
+        delete[] meta;
+        for (size_t i = 0; i < n_; i++) buff.c(values_[i]);
+        return buff.c_str();
+    }
+
+    /* Checks if this message equals the given object */
+    bool equals(Object* o) {
+        MultiReply* other = dynamic_cast<MultiReply*>(o);
+        if (other == nullptr || other->size() != n_ || other->get_id() != id_) return false;
+        for (size_t i = 0; i < n_; i++) {
+            if (strcmp(other->get_value(i), values_[i]) != 0) return false;
+        }
+        return true;
+    }
+
+    /* Returns this MultiReply */
+    MultiReply* as_multi_reply() {
+        return this;
+    }
+};
+
+/**
+ * A message that is part of a cluster-wide barrier (see KVStore::barrier()). The barrier runs
+ * node to node, without a server: in round r every node sends one of these to the node 2^r after
+ * it and waits for the one from the node 2^r before it. The epoch numbers the barrier, counting
+ * the barriers and collective operations in the order that every node enters them, so messages
+ * for a later barrier that arrive early are not taken for this one. The sender's index stands in
+ * for the round, since a node hears from a different node in each round of a barrier.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Barrier : public Message {
+public:
+    // The number of the barrier that this message is part of
+    size_t epoch_;
+    // The index of the node that sent this message
+    size_t sender_;
+
+    /* Constructor */
+    Barrier(size_t epoch, size_t sender) : epoch_(epoch), sender_(sender) {
+        kind_ = MsgKind::Barrier;
+    }
+
+    /* Returns the number of the barrier that this message is part of */
+    size_t get_epoch() { return epoch_; }
+
+    /* Returns the index of the node that sent this message */
+    size_t get_sender() { return sender_; }
+
+    /* Returns a serialized representation of this message */
+    const char* serialize() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the barrier number
+        const char* serial_epoch = Serializer::serialize_size_t(epoch_);
+        buff.c(serial_epoch);
+        delete[] serial_epoch;
+        // serialize the sender's node index
+        const char* serial_sender = Serializer::serialize_size_t(sender_);
+        buff.c(serial_sender);
+        delete[] serial_sender;
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Checks if this message equals the given object */
+    bool equals(Object* o) {
+        Barrier* other = dynamic_cast<Barrier*>(o);
+        if (other == nullptr) return false;
+        return other->get_epoch() == epoch_ && other->get_sender() == sender_;
+    }
+
+    /* Returns this Barrier */
+    Barrier* as_barrier() {
+        return this;
+    }
+};
+
+/**
+ * Asks a node for a report of its traffic, request latencies, and hottest keys. The node sends
+ * the report back as the value of a Reply to this request.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Stats : public Message {
+public:
+    // The ID of this request
+    size_t id_;
+
+    /* Constructor */
+    Stats(size_t id) : id_(id) {
+        kind_ = MsgKind::Stats;
+    }
+
+    /* Returns the ID of this request */
+    size_t get_id() { return id_; }
+
+    /* Returns a serialized representation of this message */
+    const char* serialize() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the request ID
+        const char* serial_id = Serializer::serialize_size_t(id_);
+        buff.c(serial_id);
+        delete[] serial_id;
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Checks if this message equals the given object */
+    bool equals(Object* o) {
+        Stats* other = dynamic_cast<Stats*>(o);
+        if (other == nullptr) return false;
+        return other->get_id() == id_;
+    }
+
+    /* Returns this Stats */
+    Stats* as_stats() {
+        return this;
+    }
+};
+
+/**
+ * Carries one node's value in a step of a broadcast, reduce, or allgather. Like a Barrier, it is
+ * numbered by the collective operation that it is part of and by its sender, so the receiver can
+ * match it to the step that waits for it however early it arrives.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Collective : public Message {
+public:
+    // The number of the collective operation that this message is part of
+    size_t epoch_;
+    // The index of the node that sent this message
+    size_t sender_;
+    const char* v_; // external
+
+    /* Constructor */
+    Collective(size_t epoch, size_t sender, const char* v) : epoch_(epoch), sender_(sender),
+        v_(v) {
+        kind_ = MsgKind::Collective;
+    }
+
+    /* Returns the number of the collective operation that this message is part of */
+    size_t get_epoch() { return epoch_; }
+
+    /* Returns the index of the node that sent this message */
+    size_t get_sender() { return sender_; }
+
+    /* Returns this message's value */
+    const char* get_value() { return v_; }
+
+    /* Returns a serialized representation of this message's fields, without the value */
+    const char* serialize_meta() {
+        StrBuff buff;
+        // serialize the MsgKind
+        const char* serial_kind = Serializer::serialize_size_t((size_t)kind_);
+        buff.c(serial_kind);
+        delete[] serial_kind;
+        // serialize the operation number
+        const char* serial_epoch = Serializer::serialize_size_t(epoch_);
+        buff.c(serial_epoch);
+        delete[] serial_epoch;
+        // serialize the sender's node index
+        const char* serial_sender = Serializer::serialize_size_t(sender_);
+        buff.c(serial_sender);
+        delete[] serial_sender;
+        buff.c("\n");
+        return buff.c_str();
+    }
+
+    /* Returns a serialized representation of this message: its fields followed by the value */
+    const char* serialize() {
+        StrBuff buff;
+        const char* meta = serialize_meta();
+        buff.c(meta);
+        delete[] meta;
+        buff.c(v_);
+        return buff.c_str();
+    }
+
+    /* Checks if this message equals the given object */
+    bool equals(Object* o) {
+        Collective* other = dynamic_cast<Collective*>(o);
+        if (other == nullptr) return false;
+        return other->get_epoch() == epoch_ && other->get_sender() == sender_ &&
+            strcmp(other->get_value(), v_) == 0;
+    }
+
+    /* Returns this Collective */
+    Collective* as_collective() {
+        return this;
+    }
+};
@@ -0,0 +1,156 @@
+//lang::Cpp
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "object.h"
+#include "config.h"
+
+/**
+ * Decides which node a DataFrame chunk is stored on. A policy only runs on the node that builds
+ * the DataFrame: the home it picks is recorded in the chunk's Key, so readers never consult it,
+ * and nodes with different policies can share a cluster.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PlacementPolicy : public Object {
+public:
+    // The number of nodes to place chunks on
+    size_t nodes_;
+
+    /** Constructor for a policy over the given number of nodes */
+    PlacementPolicy(size_t nodes) : nodes_(nodes) { }
+
+    /** Destructor */
+    virtual ~PlacementPolicy() { }
+
+    /**
+     * Returns the home node of the chunk with the given key string and index within its column.
+     * origin is the index of the node that is building the column.
+     */
+    virtual size_t home(const char* key, size_t chunk, size_t origin) = 0;
+
+    /**
+     * Returns the home node of a whole DataFrame with the given name. Unlike a chunk's home, this
+     * is worked out again by every node that looks the DataFrame up, so every node must use the
+     * same placement settings.
+     */
+    virtual size_t home_of(const char* name) { return hash(name) % nodes_; }
+
+    /** Returns a 64-bit FNV-1a hash of the given string, which is the same on every node. */
+    static uint64_t hash(const char* s) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (; *s != '\0'; s++) {
+            h ^= (unsigned char)*s;
+            h *= 0x100000001b3ull;
+        }
+        // Mix the bits, since FNV alone spreads short, similar strings poorly over the ring
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /** Returns the policy that the given settings ask for, for the given number of nodes. */
+    static PlacementPolicy* make(KVConfig& cfg, size_t nodes);
+};
+
+/**
+ * Places chunk i on node i % N, so the chunks of a column are dealt out round robin starting
+ * from node 0. This is the default, and it keeps the chunks of every column perfectly balanced,
+ * but changing N moves nearly every chunk.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ModuloPlacement : public PlacementPolicy {
+public:
+    /** Constructor for a policy over the given number of nodes */
+    ModuloPlacement(size_t nodes) : PlacementPolicy(nodes) { }
+
+    size_t home(const char* key, size_t chunk, size_t origin) { return chunk % nodes_; }
+};
+
+/**
+ * Places each chunk by consistent hashing. Every node owns a number of virtual points on a ring
+ * of 64-bit hashes, and a chunk goes to the owner of the first point at or after the hash of
+ * its key. Adding a node only takes over the chunks that now fall on its points, about 1/N of
+ * them, and leaves the rest where they were.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class RingPlacement : public PlacementPolicy {
+public:
+    // The points on the ring and the node that owns each one, sorted by point
+    std::vector<std::pair<uint64_t, size_t>> ring_;
+
+    /** Constructor for a ring over the given number of nodes with the given points per node */
+    RingPlacement(size_t nodes, size_t vnodes) : PlacementPolicy(nodes) {
+        char name[64];
+        for (size_t i = 0; i < nodes_; i++) {
+            for (size_t v = 0; v < vnodes; v++) {
+                snprintf(name, sizeof(name), "node-%zu#%zu", i, v);
+                ring_.push_back(std::make_pair(hash(name), i));
+            }
+        }
+        std::sort(ring_.begin(), ring_.end());
+    }
+
+    size_t home(const char* key, size_t chunk, size_t origin) {
+        std::pair<uint64_t, size_t> probe(hash(key), 0);
+        std::vector<std::pair<uint64_t, size_t>>::iterator it =
+            std::lower_bound(ring_.begin(), ring_.end(), probe);
+        if (it == ring_.end()) it = ring_.begin();
+        return it->second;
+    }
+
+    size_t home_of(const char* name) { return home(name, 0, 0); }
+};
+
+/**
+ * Keeps the first few chunks of every column on the node that built it and hands the rest to
+ * another policy. A small DataFrame, such as a scalar or a short list of ids that one node sends
+ * another, then lives in one place and is fetched in one round trip instead of being scattered
+ * a chunk at a time, while large ones are still spread out.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SizedPlacement : public PlacementPolicy {
+public:
+    // The number of leading chunks that stay on the column's own node
+    size_t small_chunks_;
+    // The policy for the chunks after those, owned
+    PlacementPolicy* rest_;
+
+    /** Constructor, takes ownership of the given policy */
+    SizedPlacement(size_t nodes, size_t small_chunks, PlacementPolicy* rest) :
+        PlacementPolicy(nodes), small_chunks_(small_chunks), rest_(rest) { }
+
+    /** Destructor */
+    ~SizedPlacement() { delete rest_; }
+
+    size_t home(const char* key, size_t chunk, size_t origin) {
+        if (chunk < small_chunks_) return origin;
+        return rest_->home(key, chunk, origin);
+    }
+
+    size_t home_of(const char* name) { return rest_->home_of(name); }
+};
+
+inline PlacementPolicy* PlacementPolicy::make(KVConfig& cfg, size_t nodes) {
+    switch (cfg.placement_) {
+        case Placement::Ring: return new RingPlacement(nodes, cfg.ring_vnodes_);
+        case Placement::Sized:
+            return new SizedPlacement(nodes, cfg.small_chunks_,
+                new RingPlacement(nodes, cfg.ring_vnodes_));
+        default: return new ModuloPlacement(nodes);
+    }
+}
@@ -76,7 +76,7 @@ public:
 
 /** Returns a serialized representation of this string.
  *  Declared here to avoid circular dependency. */
-const char* String::serialize() {
+inline const char* String::serialize() {
     // serialize the length and c string value
     char* serial_len = Serializer::serialize_size_t(size_);
     // resulting char* needs to be big enough to hold the serialized length, cstr_, and a null
@@ -0,0 +1,303 @@
+//lang::Cpp
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "map.h"
+#include "blob.h"
+#include "spill.h"
+
+/**
+ * A reader-writer lock. Any number of threads can hold it shared at once, or one thread can hold
+ * it exclusively. lock() and unlock() take and release it exclusively, so it can be used with
+ * std::unique_lock and std::condition_variable_any.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class RWLock : public Object {
+public:
+    pthread_rwlock_t rw_;
+
+    /** Constructor */
+    RWLock() {
+        exit_if_not(pthread_rwlock_init(&rw_, nullptr) == 0,
+            "Call to pthread_rwlock_init() failed");
+    }
+
+    /** Destructor */
+    ~RWLock() { pthread_rwlock_destroy(&rw_); }
+
+    /** Takes the lock exclusively. */
+    void lock() { pthread_rwlock_wrlock(&rw_); }
+
+    /** Releases the exclusive lock. */
+    void unlock() { pthread_rwlock_unlock(&rw_); }
+
+    /** Takes the lock shared. */
+    void lock_shared() { pthread_rwlock_rdlock(&rw_); }
+
+    /** Releases the shared lock. */
+    void unlock_shared() { pthread_rwlock_unlock(&rw_); }
+};
+
+/**
+ * One value in a ShardedMap, along with what the memory budget needs to know about it.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Slot_ : public Blob {
+public:
+    // Has the value been read or written since the eviction sweep last passed it?
+    std::atomic<bool> used_;
+    // Is the value in the spill file rather than on the heap?
+    bool spilled_;
+
+    /** Constructor for a slot holding the given value on the heap */
+    Slot_(Blob& v) : Blob(v), used_(true), spilled_(false) { }
+};
+
+/**
+ * A map from Strings to Blobs that is split into a fixed number of shards, each a Map with its
+ * own RWLock. A key always lives in the shard picked by its hash, so operations on keys in
+ * different shards never wait on each other, and reads of keys in the same shard only wait on
+ * writes.
+ *
+ * The methods that end in _locked expect the caller to already hold the key's shard lock, which
+ * lets the caller do more work atomically with the map operation.
+ *
+ * The map can be given a memory budget. Once the values on the heap add up to more than that,
+ * enforce_budget() moves values that have not been used lately into a SpillFile, picking them
+ * with the clock algorithm: a sweep goes around the map, spilling values whose used_ flag is
+ * clear and clearing the flag on the rest. A get of a spilled value copies it back onto the heap.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ShardedMap : public Object {
+public:
+    // The number of shards
+    size_t n_;
+    // The shards, owned
+    Map** shards_;
+    // The lock for each shard
+    RWLock* locks_;
+    // The most bytes of values to keep on the heap, or 0 for no limit
+    size_t budget_;
+    // Where values go when the map is over budget, or nullptr if there is no budget
+    std::shared_ptr<SpillFile> spill_;
+    // The number of value bytes on the heap
+    std::atomic<size_t> resident_;
+    // The number of values moved into the spill file
+    std::atomic<size_t> spills_;
+    // The number of spilled values copied back onto the heap
+    std::atomic<size_t> reloads_;
+    // Held by the thread that is running an eviction sweep
+    std::mutex evict_mtx_;
+    // The shard and bucket where the next eviction sweep starts. Guarded by evict_mtx_
+    size_t hand_shard_;
+    size_t hand_bucket_;
+
+    /** Constructor for a map with the given number of shards */
+    ShardedMap(size_t n) : n_(n), budget_(0), resident_(0), spills_(0), reloads_(0),
+        hand_shard_(0), hand_bucket_(0) {
+        exit_if_not(n_ > 0, "A ShardedMap needs at least one shard");
+        shards_ = new Map*[n_];
+        // Every shard starts out small because each Map bucket is costly to allocate
+        for (size_t i = 0; i < n_; i++) shards_[i] = new Map(1);
+        locks_ = new RWLock[n_];
+    }
+
+    /** Destructor */
+    ~ShardedMap() {
+        for (size_t i = 0; i < n_; i++) delete shards_[i];
+        delete[] shards_;
+        delete[] locks_;
+    }
+
+    /** Returns the number of shards. */
+    size_t shards() { return n_; }
+
+    /**
+     * Limits the values kept on the heap to the given number of bytes. Values past the budget
+     * are spilled to a file in the given directory, named after the given node.
+     */
+    void set_budget(size_t bytes, const char* dir, size_t idx) {
+        budget_ = bytes;
+        spill_ = std::make_shared<SpillFile>(dir, idx);
+    }
+
+    /**
+     * Returns the index of the shard that holds the given key. The shard comes from the high bits
+     * of the scrambled hash, because each shard's Map picks buckets with the low bits; taking
+     * both from the low bits would put every key of a shard in the same few buckets.
+     */
+    size_t shard_of(String& k) {
+        uint64_t h = (uint64_t)k.hash() * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h >> 32) % n_;
+    }
+
+    /** Returns the lock of the shard that holds the given key. */
+    RWLock& lock_for(String& k) { return locks_[shard_of(k)]; }
+
+    /**
+     * Puts the given value at the given key, replacing any value already there. Handles to the
+     * old value that were handed out by get() keep it alive.
+     */
+    void put(String& k, Blob& v) {
+        RWLock& l = lock_for(k);
+        l.lock();
+        put_locked(k, v);
+        l.unlock();
+        enforce_budget();
+    }
+
+    /**
+     * Like put(), for a caller that holds the key's shard lock exclusively. The caller should
+     * call enforce_budget() once it has released the lock.
+     */
+    void put_locked(String& k, Blob& v) {
+        Map* m = shards_[shard_of(k)];
+        Slot_* old = dynamic_cast<Slot_*>(m->get(k));
+        if (old != nullptr && !old->spilled_) resident_ -= old->size();
+        resident_ += v.size();
+        m->put(k, new Slot_(v));
+    }
+
+    /**
+     * Returns a handle to the value at the given key, or an empty one if the key is not in the
+     * map. The handle is taken under the shard's shared lock, so a concurrent put cannot delete
+     * the value before the handle holds it, and no bytes are copied.
+     */
+    Blob get(String& k) {
+        RWLock& l = lock_for(k);
+        l.lock_shared();
+        Slot_* v = dynamic_cast<Slot_*>(shards_[shard_of(k)]->get(k));
+        Blob res;
+        bool spilled = false;
+        if (v != nullptr) {
+            res = *v;
+            spilled = v->spilled_;
+            v->used_ = true;
+        }
+        l.unlock_shared();
+        if (spilled) res = reload_(k);
+        return res;
+    }
+
+    /**
+     * Copies the spilled value at the given key back onto the heap and returns a handle to it.
+     * Another thread may have reloaded or replaced it in the meantime, in which case that value
+     * is returned instead.
+     */
+    Blob reload_(String& k) {
+        RWLock& l = lock_for(k);
+        l.lock();
+        Slot_* v = dynamic_cast<Slot_*>(shards_[shard_of(k)]->get(k));
+        if (v->spilled_) {
+            Blob heap(v->copy());
+            v->Blob::operator=(heap);
+            v->spilled_ = false;
+            resident_ += v->size();
+            reloads_++;
+        }
+        Blob res = *v;
+        l.unlock();
+        enforce_budget();
+        return res;
+    }
+
+    /**
+     * Spills values that have not been used lately until the values on the heap fit in the
+     * budget again, or until two sweeps of the whole map find nothing more to spill. Returns
+     * right away if the map is within budget or another thread is already sweeping. Must be
+     * called without holding any shard lock.
+     */
+    void enforce_budget() {
+        if (budget_ == 0 || resident_ <= budget_) return;
+        std::unique_lock<std::mutex> lk(evict_mtx_, std::try_to_lock);
+        if (!lk.owns_lock()) return;
+        size_t idle = 0;
+        while (resident_ > budget_ && idle < 2 * n_) {
+            size_t shard = hand_shard_;
+            locks_[shard].lock();
+            bool spilled = sweep_(shard);
+            locks_[shard].unlock();
+            idle = spilled ? 0 : idle + 1;
+        }
+    }
+
+    /**
+     * Sweeps the given shard from the clock hand, spilling unused values until the map fits in
+     * the budget, and moves the hand on. The caller holds the shard's lock exclusively.
+     *
+     * @return Whether anything was spilled
+     */
+    bool sweep_(size_t shard) {
+        Map* m = shards_[shard];
+        bool spilled = false;
+        for (size_t b = hand_bucket_; b < m->capacity_; b++) {
+            for (size_t i = 0; i < m->items_[b].vals_.size(); i++) {
+                Slot_* v = dynamic_cast<Slot_*>(m->items_[b].vals_.get(i));
+                // Values smaller than a page would take more room in the spill file than they
+                // save on the heap
+                if (v->spilled_ || v->size() < spill_->page_) continue;
+                if (v->used_) {
+                    v->used_ = false;
+                    continue;
+                }
+                Blob mapped = spill_->spill(*v);
+                resident_ -= v->size();
+                v->Blob::operator=(mapped);
+                v->spilled_ = true;
+                spills_++;
+                spilled = true;
+                if (resident_ <= budget_) {
+                    // Pick up from the next bucket next time
+                    hand_bucket_ = b + 1;
+                    return true;
+                }
+            }
+        }
+        hand_shard_ = (shard + 1) % n_;
+        hand_bucket_ = 0;
+        return spilled;
+    }
+
+    /**
+     * Adds every key in the given shard and a handle to its value to the given list. The shard
+     * is only locked while the handles are taken, not while the caller uses them.
+     */
+    void entries(size_t shard, std::vector<std::pair<std::string, Blob>>& out) {
+        locks_[shard].lock_shared();
+        Map* m = shards_[shard];
+        for (size_t b = 0; b < m->capacity_; b++) {
+            for (size_t i = 0; i < m->items_[b].keys_.size(); i++) {
+                String* k = dynamic_cast<String*>(m->items_[b].keys_.get(i));
+                Slot_* v = dynamic_cast<Slot_*>(m->items_[b].vals_.get(i));
+                out.push_back(std::make_pair(std::string(k->c_str(), k->size()), Blob(*v)));
+            }
+        }
+        locks_[shard].unlock_shared();
+    }
+
+    /** Is the given key in the map? */
+    bool contains(String& k) {
+        RWLock& l = lock_for(k);
+        l.lock_shared();
+        bool res = contains_locked(k);
+        l.unlock_shared();
+        return res;
+    }
+
+    /** Like contains(), for a caller that holds the key's shard lock. */
+    bool contains_locked(String& k) {
+        return shards_[shard_of(k)]->contains(k);
+    }
+};
@@ -0,0 +1,86 @@
+//lang::Cpp
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "blob.h"
+#include "string.h"
+
+/**
+ * A file that values are moved into when a node is over its memory budget. Each spilled value
+ * gets its own page-aligned span of the file, which is mapped back into memory read-only, so
+ * the kernel pages it in when it is read and can drop it again under memory pressure. Once the
+ * last handle to a spilled value lets go, its span is unmapped and punched out of the file.
+ *
+ * The file is unlinked as soon as it is opened, so it goes away with the process. Spilled values
+ * hold a shared_ptr to it, so it stays open until the last of them is gone.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SpillFile : public Object, public std::enable_shared_from_this<SpillFile> {
+public:
+    // The open, unlinked file
+    int fd_;
+    // The offset where the next value goes
+    size_t end_;
+    // The size of a page, which every span is rounded up to
+    size_t page_;
+    // The number of value bytes that are in the file right now
+    std::atomic<size_t> bytes_;
+    // The lock that guards end_
+    std::mutex mtx_;
+
+    /** Constructor for a spill file for the given node in the given directory */
+    SpillFile(const char* dir, size_t idx) : end_(0), page_(sysconf(_SC_PAGESIZE)), bytes_(0) {
+        StrBuff buff(dir);
+        buff.c("/eau2-spill-");
+        buff.c(idx);
+        buff.c("-");
+        buff.c((size_t)getpid());
+        char* path = buff.c_str();
+        fd_ = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        exit_if_not(fd_ >= 0, "Could not open the spill file");
+        unlink(path);
+        delete[] path;
+    }
+
+    /** Destructor */
+    ~SpillFile() { close(fd_); }
+
+    /**
+     * Writes the given value to the file and returns a handle to the copy of it that is mapped
+     * back in. The caller can drop its heap copy once it holds the new handle.
+     */
+    Blob spill(Blob& v) {
+        // The terminator is written too, so that the mapped bytes are still a C string
+        size_t len = v.size() + 1;
+        size_t span = (len + page_ - 1) / page_ * page_;
+        mtx_.lock();
+        size_t off = end_;
+        end_ += span;
+        mtx_.unlock();
+        const char* src = v.c_str();
+        for (size_t done = 0; done < len; ) {
+            ssize_t n = pwrite(fd_, src + done, len - done, off + done);
+            exit_if_not(n > 0, "Could not write to the spill file");
+            done += n;
+        }
+        void* m = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd_, off);
+        exit_if_not(m != MAP_FAILED, "Could not map the spill file");
+        bytes_ += v.size();
+        std::shared_ptr<SpillFile> self = shared_from_this();
+        size_t size = v.size();
+        return Blob((char*)m, size, [self, m, len, off, span, size]() {
+            munmap(m, len);
+            fallocate(self->fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off, span);
+            self->bytes_ -= size;
+        });
+    }
+};
@@ -0,0 +1,259 @@
+//lang::Cpp
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "object.h"
+#include "string.h"
+#include "message.h"
+
+// The number of buckets in a LatencyHistogram. Bucket i counts latencies of less than 2^i us
+// that did not fit in bucket i - 1, and the last bucket counts everything longer
+#define LATENCY_BUCKETS 32
+// The number of keys that a HotKeys keeps track of
+#define HOT_KEYS 16
+
+/**
+ * A histogram of latencies in buckets that double in width, so that it covers microseconds to
+ * minutes in a fixed amount of space and can be recorded into without a lock.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class LatencyHistogram : public Object {
+public:
+    // The number of latencies in each bucket
+    std::atomic<size_t> buckets_[LATENCY_BUCKETS];
+    // The number of latencies recorded
+    std::atomic<size_t> count_;
+    // The sum of the latencies recorded, in microseconds
+    std::atomic<size_t> total_us_;
+
+    /** Constructor for an empty histogram */
+    LatencyHistogram() : count_(0), total_us_(0) {
+        for (size_t i = 0; i < LATENCY_BUCKETS; i++) buckets_[i] = 0;
+    }
+
+    /** Records a latency of the given number of microseconds. */
+    void record(size_t us) {
+        size_t b = 0;
+        while (b < LATENCY_BUCKETS - 1 && us >= ((size_t)1 << b)) b++;
+        buckets_[b]++;
+        count_++;
+        total_us_ += us;
+    }
+
+    /**
+     * Returns an upper bound on the given fraction of the latencies, in microseconds: the top of
+     * the bucket that the latency at that rank falls in. Returns 0 if nothing was recorded.
+     */
+    size_t percentile(double p) {
+        size_t n = count_;
+        if (n == 0) return 0;
+        size_t rank = (size_t)(p * n);
+        if (rank >= n) rank = n - 1;
+        size_t seen = 0;
+        for (size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += buckets_[b];
+            if (seen > rank) return (size_t)1 << b;
+        }
+        return (size_t)1 << (LATENCY_BUCKETS - 1);
+    }
+
+    /** Appends one line describing this histogram, after the given label, to the given buffer. */
+    void report(StrBuff& buff, const char* label) {
+        size_t n = count_;
+        if (n == 0) return;
+        buff.c(label);
+        buff.c(" count ").c(n);
+        buff.c(" mean_us ").c(total_us_ / n);
+        buff.c(" p50_us ").c(percentile(0.5));
+        buff.c(" p99_us ").c(percentile(0.99));
+        buff.c("\n");
+    }
+};
+
+/**
+ * The keys that were read the most, found with the space-saving algorithm: a fixed number of
+ * counters, where a key that is not being counted takes over the smallest counter and adds one
+ * to it. Every key read more than 1/HOT_KEYS of the time is sure to be in the table, and each
+ * count is off by at most the count it took over.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class HotKeys : public Object {
+public:
+    // The keys being counted and their counts
+    std::vector<std::pair<std::string, size_t>> top_;
+    // The lock that guards top_
+    std::mutex mtx_;
+
+    /** Counts one read of the given key. */
+    void hit(const char* key) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        size_t min = 0;
+        for (size_t i = 0; i < top_.size(); i++) {
+            if (top_[i].first == key) {
+                top_[i].second++;
+                return;
+            }
+            if (top_[i].second < top_[min].second) min = i;
+        }
+        if (top_.size() < HOT_KEYS) top_.push_back(std::make_pair(std::string(key), (size_t)1));
+        else top_[min] = std::make_pair(std::string(key), top_[min].second + 1);
+    }
+
+    /** Appends a line for each key being counted, most read first, to the given buffer. */
+    void report(StrBuff& buff) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::vector<std::pair<std::string, size_t>> sorted(top_);
+        for (size_t i = 1; i < sorted.size(); i++) {
+            for (size_t j = i; j > 0 && sorted[j].second > sorted[j - 1].second; j--) {
+                std::swap(sorted[j], sorted[j - 1]);
+            }
+        }
+        for (size_t i = 0; i < sorted.size(); i++) {
+            buff.c("hot ").c(sorted[i].first.c_str()).c(" ").c(sorted[i].second).c("\n");
+        }
+    }
+};
+
+/**
+ * Everything that one KVStore measures about its traffic: the number of messages and bytes of
+ * each kind that it sent to and received from each other node, how long its requests took by
+ * kind and by node, and which of its keys other nodes read the most. Every counter can be bumped
+ * by any thread without a lock.
+ *
+ * report() writes it all out as text, one "what details... numbers" line per nonzero counter,
+ * which is what a Stats request gets back from another node.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class NodeStats : public Object {
+public:
+    // The index of the node being measured
+    size_t idx_;
+    // The number of nodes. Traffic on a socket whose node is not known yet is counted as if it
+    // came from node nodes_
+    size_t nodes_;
+    // The messages and bytes sent and received, indexed by kind * (nodes_ + 1) + node. Messages
+    // of a kind this node does not know are counted as kind MSG_KINDS
+    std::atomic<size_t>* sent_msgs_;
+    std::atomic<size_t>* sent_bytes_;
+    std::atomic<size_t>* recv_msgs_;
+    std::atomic<size_t>* recv_bytes_;
+    // The time from sending each kind of request to getting its response
+    LatencyHistogram* by_kind_;
+    // The time from sending a request to each node to getting its response
+    LatencyHistogram* by_node_;
+    // The keys of this node's map that other nodes read the most
+    HotKeys hot_;
+
+    /** Constructor for the stats of the given node in a cluster of the given size */
+    NodeStats(size_t idx, size_t nodes) : idx_(idx), nodes_(nodes) {
+        size_t n = (MSG_KINDS + 1) * (nodes_ + 1);
+        sent_msgs_ = new std::atomic<size_t>[n];
+        sent_bytes_ = new std::atomic<size_t>[n];
+        recv_msgs_ = new std::atomic<size_t>[n];
+        recv_bytes_ = new std::atomic<size_t>[n];
+        for (size_t i = 0; i < n; i++) {
+            sent_msgs_[i] = 0;
+            sent_bytes_[i] = 0;
+            recv_msgs_[i] = 0;
+            recv_bytes_[i] = 0;
+        }
+        by_kind_ = new LatencyHistogram[MSG_KINDS];
+        by_node_ = new LatencyHistogram[nodes_];
+    }
+
+    /** Destructor */
+    ~NodeStats() {
+        delete[] sent_msgs_;
+        delete[] sent_bytes_;
+        delete[] recv_msgs_;
+        delete[] recv_bytes_;
+        delete[] by_kind_;
+        delete[] by_node_;
+    }
+
+    /** Returns the index of the counters for the given kind and node. */
+    size_t slot_(size_t kind, size_t node) {
+        if (kind > MSG_KINDS) kind = MSG_KINDS;
+        if (node > nodes_) node = nodes_;
+        return kind * (nodes_ + 1) + node;
+    }
+
+    /** Counts a message of the given kind and size that was sent to the given node. */
+    void sent(size_t kind, size_t node, size_t bytes) {
+        size_t s = slot_(kind, node);
+        sent_msgs_[s]++;
+        sent_bytes_[s] += bytes;
+    }
+
+    /** Counts a message of the given kind and size that was received from the given node. */
+    void received(size_t kind, size_t node, size_t bytes) {
+        size_t s = slot_(kind, node);
+        recv_msgs_[s]++;
+        recv_bytes_[s] += bytes;
+    }
+
+    /** Records how long a request of the given kind to the given node took to be answered. */
+    void answered(size_t kind, size_t node, size_t us) {
+        if (kind < MSG_KINDS) by_kind_[kind].record(us);
+        if (node < nodes_) by_node_[node].record(us);
+    }
+
+    /**
+     * Returns a text report of every nonzero counter, which the caller owns, using the given
+     * name for each kind of message. The lines are
+     *   node <idx>
+     *   sent|recv <kind> <node or ?> <messages> <bytes>
+     *   latency <kind> count <n> mean_us <us> p50_us <us> p99_us <us>
+     *   peer <node> count <n> mean_us <us> p50_us <us> p99_us <us>
+     *   hot <key> <reads>
+     */
+    char* report(const char* (*kind_name)(size_t)) {
+        StrBuff buff;
+        buff.c("node ").c(idx_).c("\n");
+        for (size_t k = 0; k <= MSG_KINDS; k++) {
+            for (size_t n = 0; n <= nodes_; n++) {
+                size_t s = slot_(k, n);
+                report_traffic_(buff, "sent ", kind_name(k), n, sent_msgs_[s], sent_bytes_[s]);
+                report_traffic_(buff, "recv ", kind_name(k), n, recv_msgs_[s], recv_bytes_[s]);
+            }
+        }
+        for (size_t k = 0; k < MSG_KINDS; k++) {
+            StrBuff label("latency ");
+            label.c(kind_name(k));
+            char* l = label.c_str();
+            by_kind_[k].report(buff, l);
+            delete[] l;
+        }
+        for (size_t n = 0; n < nodes_; n++) {
+            StrBuff label("peer ");
+            label.c(n);
+            char* l = label.c_str();
+            by_node_[n].report(buff, l);
+            delete[] l;
+        }
+        hot_.report(buff);
+        return buff.c_str();
+    }
+
+    /** Appends a line for the given traffic counters, if they are nonzero, to the given buffer. */
+    void report_traffic_(StrBuff& buff, const char* dir, const char* kind, size_t node,
+        size_t msgs, size_t bytes) {
+        if (msgs == 0) return;
+        buff.c(dir).c(kind).c(" ");
+        if (node == nodes_) buff.c("?");
+        else buff.c(node);
+        buff.c(" ").c(msgs).c(" ").c(bytes).c("\n");
+    }
+};
@@ -0,0 +1,137 @@
+//lang::Cpp
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+#include "object.h"
+
+/**
+ * A fixed-size pool of worker threads that run tasks off of a shared FIFO work queue. Keeps a
+ * few counters about the queue so that callers can tell when the workers are falling behind.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ThreadPool : public Object {
+public:
+    // The worker threads
+    std::vector<std::thread> workers_;
+    // Tasks waiting for a free worker
+    std::deque<std::function<void()>> queue_;
+    // The lock that guards every field below
+    std::mutex mtx_;
+    // Signalled when a task is queued or the pool is stopping
+    std::condition_variable cv_;
+    // Has stop() been called?
+    bool stopping_;
+    // The largest the queue has ever been
+    size_t max_depth_;
+    // The number of tasks that have been queued
+    size_t submitted_;
+    // The number of tasks that have finished running
+    size_t completed_;
+    // The number of workers that are currently running a task
+    size_t busy_;
+
+    /**
+     * Constructor that starts the given number of worker threads.
+     */
+    ThreadPool(size_t threads) : stopping_(false), max_depth_(0), submitted_(0), completed_(0),
+        busy_(0) {
+        exit_if_not(threads > 0, "A ThreadPool needs at least one thread");
+        for (size_t i = 0; i < threads; i++)
+            workers_.push_back(std::thread(&ThreadPool::work_, this));
+    }
+
+    /**
+     * Destructor. Runs every task that is still queued and then joins the workers.
+     */
+    ~ThreadPool() { stop(); }
+
+    /**
+     * Adds the given task to the back of the work queue.
+     */
+    void submit(std::function<void()> task) {
+        mtx_.lock();
+        exit_if_not(!stopping_, "Cannot submit a task to a stopped ThreadPool");
+        queue_.push_back(task);
+        submitted_++;
+        if (queue_.size() > max_depth_) max_depth_ = queue_.size();
+        mtx_.unlock();
+        cv_.notify_one();
+    }
+
+    /**
+     * Stops accepting tasks, waits for the queued ones to finish, and joins every worker.
+     */
+    void stop() {
+        mtx_.lock();
+        if (stopping_) {
+            mtx_.unlock();
+            return;
+        }
+        stopping_ = true;
+        mtx_.unlock();
+        cv_.notify_all();
+        for (size_t i = 0; i < workers_.size(); i++) workers_[i].join();
+    }
+
+    /** Returns the number of worker threads. */
+    size_t size() { return workers_.size(); }
+
+    /** Returns the number of tasks waiting for a worker. */
+    size_t queue_depth() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return queue_.size();
+    }
+
+    /** Returns the largest the work queue has ever been. */
+    size_t max_queue_depth() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return max_depth_;
+    }
+
+    /** Returns the number of tasks that have been queued. */
+    size_t submitted() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return submitted_;
+    }
+
+    /** Returns the number of tasks that have finished running. */
+    size_t completed() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return completed_;
+    }
+
+    /** Returns the number of workers that are running a task right now. */
+    size_t busy() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return busy_;
+    }
+
+    /**
+     * The loop run by every worker: takes the task at the front of the queue and runs it, until
+     * the pool is stopped and the queue is empty.
+     */
+    void work_() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        for (;;) {
+            while (queue_.empty() && !stopping_) cv_.wait(lk);
+            if (queue_.empty()) return;
+            std::function<void()> task = queue_.front();
+            queue_.pop_front();
+            busy_++;
+            lk.unlock();
+            task();
+            lk.lock();
+            busy_--;
+            completed_++;
+        }
+    }
+};
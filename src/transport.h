@@ -0,0 +1,370 @@
+//lang::Cpp
+
+// The TCP socket setup in this file was interpreted from Beej's Guide to Network Programming
+
+#pragma once
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <ifaddrs.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "object.h"
+
+/**
+ * The way that a KVStore opens stream sockets to other nodes. Every transport hands back plain
+ * file descriptors, so the event loop, framing, and send path work the same no matter which one
+ * a connection came from. Nodes are always named by an IP address and port; a transport that
+ * does not use IP maps them onto its own kind of address.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Transport : public Object {
+public:
+    /**
+     * Creates a socket that listens for connections to the node at the given address, and
+     * returns its fd. Exits if the socket cannot be set up.
+     */
+    virtual int listen_on(const char* ip, const char* port) = 0;
+
+    /**
+     * Connects to the node at the given address and returns the fd of the new socket, or -1 if
+     * the node is not listening yet.
+     */
+    virtual int connect_to(const char* ip, const char* port) = 0;
+
+    /**
+     * Accepts the next connection waiting on the given listening fd and returns the fd of the new
+     * socket, or -1 with errno set to EAGAIN if there is none.
+     */
+    virtual int accept_on(int listen_fd) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        return accept(listen_fd, (struct sockaddr*)&addr, &len);
+    }
+
+    /** Stops listening on the given fd, which listen_on() returned. */
+    virtual void close_listener(int listen_fd) { close(listen_fd); }
+
+    /** Sets any per-socket options that this transport wants on a newly opened connection. */
+    virtual void tune(int fd) { }
+
+    /**
+     * Returns how long the given message from node src to node dst should be held back before it
+     * is sent, in microseconds, to stand in for the latency of a real network. seq numbers the
+     * messages sent over one connection.
+     */
+    virtual size_t latency_us(size_t src, size_t dst, size_t seq) { return 0; }
+
+    /**
+     * Returns how long a connection should stay busy sending a message of the given number of
+     * bytes, in microseconds, to stand in for the bandwidth of a real network.
+     */
+    virtual size_t transmit_us(size_t bytes) { return 0; }
+
+    /** Returns the name of this transport, for log messages. */
+    virtual const char* name() = 0;
+};
+
+/**
+ * Plain TCP over IPv4, used between nodes on different hosts.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class TcpTransport : public Transport {
+public:
+    int listen_on(const char* ip, const char* port) {
+        struct addrinfo* info = resolve_(ip, port);
+        int fd;
+        exit_if_not((fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) >= 0,
+            "Call to socket() failed");
+        // Allow the address to be reused right away so that back-to-back runs don't fail to bind
+        int yes = 1;
+        exit_if_not(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == 0,
+            "Call to setsockopt() failed");
+        exit_if_not(bind(fd, info->ai_addr, info->ai_addrlen) >= 0, "Call to bind() failed");
+        freeaddrinfo(info);
+        exit_if_not(listen(fd, SOMAXCONN) == 0, "Call to listen() failed");
+        return fd;
+    }
+
+    int connect_to(const char* ip, const char* port) {
+        struct addrinfo* info = resolve_(ip, port);
+        int fd;
+        exit_if_not((fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) >= 0,
+            "Call to socket() failed");
+        int cnct = connect(fd, info->ai_addr, info->ai_addrlen);
+        freeaddrinfo(info);
+        if (cnct < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * Turns off Nagle's algorithm so that back to back requests are not held back waiting on the
+     * Acks of earlier ones.
+     */
+    void tune(int fd) {
+        int yes = 1;
+        exit_if_not(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) == 0,
+            "Call to setsockopt() failed");
+    }
+
+    const char* name() { return "tcp"; }
+
+    /** Returns the address info for the given IPv4 address and port. The caller frees it. */
+    struct addrinfo* resolve_(const char* ip, const char* port) {
+        struct addrinfo hints;
+        struct addrinfo* info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        exit_if_not(getaddrinfo(ip, port, &hints, &info) == 0, "Call to getaddrinfo() failed");
+        return info;
+    }
+};
+
+/**
+ * Unix domain stream sockets, used between nodes on the same host. They skip the TCP/IP stack
+ * entirely, so each message costs fewer instructions in the kernel and there are no checksums,
+ * acks, or congestion windows between two processes that share memory anyway.
+ *
+ * Sockets live in the abstract namespace, named after the IP and port the node would use for
+ * TCP, so there are no socket files to clean up after a crash.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class UnixTransport : public Transport {
+public:
+    int listen_on(const char* ip, const char* port) {
+        struct sockaddr_un addr;
+        socklen_t len = address_(ip, port, &addr);
+        int fd;
+        exit_if_not((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0, "Call to socket() failed");
+        exit_if_not(bind(fd, (struct sockaddr*)&addr, len) >= 0, "Call to bind() failed");
+        exit_if_not(listen(fd, SOMAXCONN) == 0, "Call to listen() failed");
+        return fd;
+    }
+
+    int connect_to(const char* ip, const char* port) {
+        struct sockaddr_un addr;
+        socklen_t len = address_(ip, port, &addr);
+        int fd;
+        exit_if_not((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0, "Call to socket() failed");
+        if (connect(fd, (struct sockaddr*)&addr, len) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    const char* name() { return "unix"; }
+
+    /**
+     * Fills in the abstract socket address of the node at the given IP and port, and returns the
+     * length of the address.
+     */
+    socklen_t address_(const char* ip, const char* port, struct sockaddr_un* addr) {
+        memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        // The leading '\0' puts the name in the abstract namespace
+        int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "eau2:%s:%s", ip, port);
+        exit_if_not(n > 0 && (size_t)n < sizeof(addr->sun_path) - 1, "Invalid node address");
+        return offsetof(struct sockaddr_un, sun_path) + 1 + n;
+    }
+};
+
+/**
+ * The connections waiting to be accepted by one node listening on a LoopbackTransport. Not
+ * exposed; only LoopbackTransport creates these.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class LoopbackListener_ {
+public:
+    // The eventfd that the node watches for new connections
+    int efd_;
+    // The accepting ends of the connections made to the node that it has not accepted yet
+    std::deque<int> pending_;
+
+    /** Constructor */
+    LoopbackListener_(int efd) : efd_(efd) { }
+};
+
+/**
+ * Connections between nodes that all run in this process, as under the harness in
+ * src/cluster.h. A node "listens" by putting its address in a process-wide table, and connecting
+ * to it makes a socketpair and hands one end to the listener, so no address is ever bound in the
+ * kernel: clusters never collide with other processes or leave anything behind, and any number
+ * of them can run at once. Listeners are eventfds, which the event loop watches like sockets.
+ *
+ * It can also make the connections behave like a slower network: each message waits out a fixed
+ * latency plus up to jitter_us_ more, and then keeps its connection busy for as long as its bytes
+ * take at the given bandwidth. The jitter is a hash of the seed, the two nodes, and the message's
+ * number on its connection, so a run with the same seed and message order gets the same delays,
+ * and running with different seeds shakes out different interleavings.
+ *
+ * @author Spencer LaChance <lachance.s@northeastern.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class LoopbackTransport : public Transport {
+public:
+    // The delay added to every message, in microseconds
+    size_t latency_us_;
+    // The most extra delay added to a message, in microseconds
+    size_t jitter_us_;
+    // The bytes per second that a connection can carry, or 0 for no limit
+    size_t bytes_per_sec_;
+    // The seed of the jitter
+    size_t seed_;
+
+    /** Constructor for a transport that adds no delays */
+    LoopbackTransport() : latency_us_(0), jitter_us_(0), bytes_per_sec_(0), seed_(0) { }
+
+    /** Constructor for a transport with the given network costs */
+    LoopbackTransport(size_t latency_us, size_t jitter_us, size_t bytes_per_sec, size_t seed) :
+        latency_us_(latency_us), jitter_us_(jitter_us), bytes_per_sec_(bytes_per_sec),
+        seed_(seed) { }
+
+    /** The listeners of every LoopbackTransport in this process, by address and by fd. */
+    class Registry_ {
+    public:
+        std::mutex mtx_;
+        std::unordered_map<std::string, LoopbackListener_*> by_name_;
+        std::unordered_map<int, LoopbackListener_*> by_fd_;
+    };
+
+    /** Returns the table of listeners shared by the whole process. */
+    static Registry_& registry_() {
+        static Registry_ r;
+        return r;
+    }
+
+    int listen_on(const char* ip, const char* port) {
+        std::string name = std::string(ip) + ":" + port;
+        int efd = eventfd(0, EFD_NONBLOCK);
+        exit_if_not(efd >= 0, "Call to eventfd() failed");
+        Registry_& r = registry_();
+        std::lock_guard<std::mutex> lk(r.mtx_);
+        exit_if_not(r.by_name_.count(name) == 0, "Address is already in use");
+        LoopbackListener_* l = new LoopbackListener_(efd);
+        r.by_name_[name] = l;
+        r.by_fd_[efd] = l;
+        return efd;
+    }
+
+    int connect_to(const char* ip, const char* port) {
+        std::string name = std::string(ip) + ":" + port;
+        Registry_& r = registry_();
+        std::lock_guard<std::mutex> lk(r.mtx_);
+        std::unordered_map<std::string, LoopbackListener_*>::iterator it = r.by_name_.find(name);
+        if (it == r.by_name_.end()) return -1;
+        int sv[2];
+        exit_if_not(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "Call to socketpair() failed");
+        it->second->pending_.push_back(sv[1]);
+        uint64_t one = 1;
+        exit_if_not(write(it->second->efd_, &one, sizeof(one)) == sizeof(one),
+            "Call to write() failed");
+        return sv[0];
+    }
+
+    int accept_on(int listen_fd) {
+        Registry_& r = registry_();
+        std::lock_guard<std::mutex> lk(r.mtx_);
+        std::unordered_map<int, LoopbackListener_*>::iterator it = r.by_fd_.find(listen_fd);
+        if (it == r.by_fd_.end() || it->second->pending_.empty()) {
+            errno = EAGAIN;
+            return -1;
+        }
+        int fd = it->second->pending_.front();
+        it->second->pending_.pop_front();
+        return fd;
+    }
+
+    void close_listener(int listen_fd) {
+        Registry_& r = registry_();
+        std::lock_guard<std::mutex> lk(r.mtx_);
+        std::unordered_map<int, LoopbackListener_*>::iterator it = r.by_fd_.find(listen_fd);
+        if (it != r.by_fd_.end()) {
+            LoopbackListener_* l = it->second;
+            // The nodes that made the connections nobody accepted see them hang up
+            for (size_t i = 0; i < l->pending_.size(); i++) close(l->pending_[i]);
+            r.by_fd_.erase(it);
+            for (std::unordered_map<std::string, LoopbackListener_*>::iterator n =
+                r.by_name_.begin(); n != r.by_name_.end(); n++) {
+                if (n->second != l) continue;
+                r.by_name_.erase(n);
+                break;
+            }
+            delete l;
+        }
+        close(listen_fd);
+    }
+
+    size_t latency_us(size_t src, size_t dst, size_t seq) {
+        if (jitter_us_ == 0) return latency_us_;
+        // splitmix64 of everything that identifies the message
+        uint64_t x = seed_ ^ (src * 0x9e3779b97f4a7c15ULL) ^ (dst * 0xc2b2ae3d27d4eb4fULL) ^
+            (seq * 0x165667b19e3779f9ULL);
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return latency_us_ + x % (jitter_us_ + 1);
+    }
+
+    size_t transmit_us(size_t bytes) {
+        if (bytes_per_sec_ == 0) return 0;
+        return (size_t)((double)bytes * 1000000 / bytes_per_sec_);
+    }
+
+    const char* name() { return "loopback"; }
+};
+
+/**
+ * Is the given host this one? That is true of the whole loopback range and of the address of
+ * every local network interface. Host names are resolved to their IPv4 address first.
+ */
+inline bool is_local_address(const char* host) {
+    struct in_addr a;
+    if (inet_pton(AF_INET, host, &a) != 1) {
+        struct addrinfo hints;
+        struct addrinfo* info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, nullptr, &hints, &info) != 0) return false;
+        a = ((struct sockaddr_in*)info->ai_addr)->sin_addr;
+        freeaddrinfo(info);
+    }
+    if ((ntohl(a.s_addr) >> 24) == 127) return true;
+    struct ifaddrs* ifs;
+    if (getifaddrs(&ifs) != 0) return false;
+    bool res = false;
+    for (struct ifaddrs* i = ifs; i != nullptr && !res; i = i->ifa_next) {
+        if (i->ifa_addr == nullptr || i->ifa_addr->sa_family != AF_INET) continue;
+        res = ((struct sockaddr_in*)i->ifa_addr)->sin_addr.s_addr == a.s_addr;
+    }
+    freeifaddrs(ifs);
+    return res;
+}
@@ -0,0 +1,78 @@
+#include "../src/chunk_cache.h"
+#include <assert.h>
+#include <string.h>
+
+/** A stand-in for a deserialized chunk that just holds a name. */
+class Named : public Object {
+public:
+    const char* name_;
+
+    Named(const char* name) : name_(name) { }
+
+    const char* name() { return name_; }
+};
+
+/** Returns a new cacheable value holding the given string. */
+std::shared_ptr<Object> make_value(const char* s) {
+    return std::shared_ptr<Object>(new Named(s));
+}
+
+/** Checks that the given cache holds the given string at the given key. */
+void check(ChunkCache& cache, const char* key, const char* expected) {
+    std::shared_ptr<Object> v = cache.get(key);
+    assert(v);
+    assert(strcmp(std::static_pointer_cast<Named>(v)->name(), expected) == 0);
+}
+
+void test_lru() {
+    ChunkCache cache(300);
+    cache.put("a", make_value("A"), 100);
+    cache.put("b", make_value("B"), 100);
+    cache.put("c", make_value("C"), 100);
+    assert(cache.bytes() == 300 && cache.size() == 3);
+    // Reading a makes b the least recently used
+    check(cache, "a", "A");
+    cache.put("d", make_value("D"), 100);
+    assert(!cache.get("b"));
+    check(cache, "a", "A");
+    check(cache, "c", "C");
+    check(cache, "d", "D");
+    assert(cache.bytes() == 300 && cache.evictions_ == 1);
+    assert(cache.hits_ == 4 && cache.misses_ == 1);
+
+    // Replacing a key charges only the new size
+    cache.put("a", make_value("A2"), 50);
+    assert(cache.bytes() == 250 && cache.size() == 3);
+    check(cache, "a", "A2");
+    cache.erase("a");
+    assert(cache.bytes() == 200 && !cache.get("a"));
+
+    // A value bigger than the budget is not cached, and does not push anything out
+    cache.put("huge", make_value("H"), 301);
+    assert(!cache.get("huge") && cache.size() == 2);
+}
+
+void test_eviction_keeps_readers() {
+    ChunkCache cache(100);
+    cache.put("a", make_value("A"), 100);
+    std::shared_ptr<Object> held = cache.get("a");
+    cache.put("b", make_value("B"), 100);
+    assert(!cache.get("a"));
+    // The evicted value lives on for whoever still holds it
+    assert(strcmp(std::static_pointer_cast<Named>(held)->name(), "A") == 0);
+    assert(held.use_count() == 1);
+}
+
+void test_disabled() {
+    ChunkCache cache(0);
+    cache.put("a", make_value("A"), 1);
+    assert(!cache.get("a") && cache.size() == 0);
+}
+
+int main() {
+    test_lru();
+    test_eviction_keeps_readers();
+    test_disabled();
+    printf("Chunk cache tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,356 @@
+#include "../src/cluster.h"
+#include "../src/dataframe.h"
+#include <assert.h>
+
+// The number of values in each node's frame
+#define ROWS 10000
+
+/**
+ * Every node of an in-process cluster builds a frame under a key homed on itself, and then reads
+ * the frame of the node after it.
+ */
+void test_ring_of_frames() {
+    Cluster cluster(4);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 4, cfg);
+        int* vals = new int[ROWS];
+        for (size_t i = 0; i < ROWS; i++) vals[i] = idx * ROWS + i;
+        char name[16];
+        snprintf(name, sizeof(name), "part-%zu", idx);
+        Key mine(name, idx);
+        delete DataFrame::fromIntArray(&mine, &kd, ROWS, vals);
+        delete[] vals;
+        size_t next = (idx + 1) % 4;
+        snprintf(name, sizeof(name), "part-%zu", next);
+        Key theirs(name, next);
+        DataFrame* df = kd.wait_and_get(theirs);
+        assert(df->nrows() == ROWS);
+        for (size_t i = 0; i < ROWS; i++) assert(df->get_int(0, i) == (int)(next * ROWS + i));
+        delete df;
+        // Nothing went over a real socket
+        assert(kd.get_kv()->fd_ < 0);
+        kd.done();
+    });
+}
+
+/** A remote get on a cluster with network latency takes at least two one way trips. */
+void test_latency() {
+    KVConfig cfg;
+    cfg.net_latency_us_ = 2000;
+    Cluster cluster(2, cfg);
+    double elapsed = 0;
+    cluster.run([&elapsed](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 2, cfg);
+        KVStore* kv = kd.get_kv();
+        Key k("lat", 0);
+        if (idx == 0) kv->put(k, kv->duplicate("I{1}"));
+        kv->barrier();
+        if (idx == 1) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            Blob v = kv->get(k);
+            std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - start;
+            elapsed = d.count();
+            assert(strcmp(v.c_str(), "I{1}") == 0);
+        }
+        kd.done();
+    });
+    assert(elapsed >= 4000);
+}
+
+/**
+ * A Rower that adds up the first int of every row it visits.
+ */
+class SumRower : public Rower {
+public:
+    long total_;
+
+    SumRower() : total_(0) { }
+
+    bool accept(Row& r) {
+        total_ += r.get_int(0);
+        return true;
+    }
+
+    void join_delete(Rower* other) {
+        total_ += dynamic_cast<SumRower*>(other)->total_;
+        delete other;
+    }
+
+    Object* clone() { return new SumRower(); }
+};
+
+/** Builds a frame of the given number of chunks on node 0, where chunk n holds n + 1's. */
+void build_chunks(KDStore& kd, Key& k, size_t chunks) {
+    size_t rows = CHUNK_SIZE * chunks;
+    int* vals = new int[rows];
+    for (size_t i = 0; i < rows; i++) vals[i] = i / CHUNK_SIZE + 1;
+    delete DataFrame::fromIntArray(&k, &kd, rows, vals);
+    delete[] vals;
+}
+
+/**
+ * With every chunk on two of three nodes, each node scans two of six chunks in local_map(), both
+ * of which it holds a copy of, and every row can still be read from the nearest copy.
+ */
+void test_replication() {
+    KVConfig cfg;
+    cfg.replication_ = 2;
+    Cluster cluster(3, cfg);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 3, cfg);
+        Key k("replicated", 0);
+        // The first three chunks are scanned on their homes and the next three on the nodes
+        // after their homes
+        if (idx == 0) build_chunks(kd, k, 6);
+        kd.barrier();
+        DataFrame* df = kd.get(k);
+        SumRower sr;
+        df->local_map(sr);
+        size_t scanned = 0;
+        for (size_t i = 0; i < df->nrows(); i++) {
+            if (df->get_scan_node(i) != idx) continue;
+            scanned++;
+            size_t home = df->get_node(i);
+            assert(home == idx || (home + 1) % 3 == idx);
+        }
+        assert(scanned == CHUNK_SIZE * 2);
+        switch (idx) {
+            case 0: assert(sr.total_ == CHUNK_SIZE * (1 + 6)); break;
+            case 1: assert(sr.total_ == CHUNK_SIZE * (2 + 4)); break;
+            case 2: assert(sr.total_ == CHUNK_SIZE * (3 + 5)); break;
+        }
+        long total = 0;
+        for (size_t i = 0; i < df->nrows(); i++) total += df->get_int(0, i);
+        assert(total == (long)CHUNK_SIZE * 21);
+        delete df;
+        kd.barrier();
+        kd.done();
+    });
+}
+
+/** Reading a frame again, even through a new DataFrame, finds its remote chunks in the cache. */
+void test_chunk_cache() {
+    Cluster cluster(3);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 3, cfg);
+        Key k("cached", 0);
+        if (idx == 0) build_chunks(kd, k, 6);
+        kd.barrier();
+        ChunkCache* cache = kd.get_kv()->chunk_cache();
+        DataFrame* df = kd.get(k);
+        long total = 0;
+        for (size_t i = 0; i < df->nrows(); i++) total += df->get_int(0, i);
+        assert(total == (long)CHUNK_SIZE * 21);
+        size_t misses = cache->misses_;
+        size_t hits = cache->hits_;
+        delete df;
+        df = kd.get(k);
+        total = 0;
+        for (size_t i = 0; i < df->nrows(); i++) total += df->get_int(0, i);
+        assert(total == (long)CHUNK_SIZE * 21);
+        // Four of the six chunks live on other nodes
+        assert(cache->misses_ == misses && cache->hits_ >= hits + 4);
+        delete df;
+        kd.barrier();
+        kd.done();
+    });
+}
+
+/**
+ * A sequential scan asks for the chunks that come next before it gets to them and keeps only a
+ * window of fetched chunks however long the frame is, and a frame deleted while its read-ahead
+ * is still outstanding gives up on it instead of waiting.
+ */
+void test_read_ahead() {
+    KVConfig cfg;
+    cfg.batch_chunks_ = 2;
+    cfg.read_ahead_chunks_ = 4;
+    cfg.net_latency_us_ = 1000;
+    Cluster cluster(3, cfg);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 3, cfg);
+        Key k("scan", 0);
+        size_t rows = CHUNK_SIZE * 30;
+        if (idx == 0) {
+            int* vals = new int[rows];
+            for (size_t i = 0; i < rows; i++) vals[i] = i;
+            delete DataFrame::fromIntArray(&k, &kd, rows, vals);
+            delete[] vals;
+        }
+        kd.barrier();
+        DataFrame* df = kd.get(k);
+        DistributedVector* dv = dynamic_cast<Column*>(df->get_columns()->get(0))->fields_;
+        if (idx != 0) {
+            // Chunk 0 is on node 0, so the first read already asks for the chunks after it
+            assert(df->get_int(0, 0) == 0);
+            for (size_t n = 1; n <= cfg.read_ahead_chunks_; n++) {
+                bool local = dv->read_node_(n) == idx;
+                assert(local || dv->fetched_[n] || dv->read_ahead_of_(n) != nullptr);
+            }
+            assert(dv->ahead_.size() > 0);
+        }
+        if (idx == 1) {
+            for (size_t i = 0; i < rows; i++) {
+                assert(df->get_int(0, i) == (int)i);
+                assert(dv->held_end_ - dv->held_start_ <= dv->window_());
+            }
+        }
+        // Node 2 never collects its read-ahead
+        delete df;
+        kd.barrier();
+        kd.done();
+    });
+}
+
+/** Any node can pull another node's metrics, and asking is itself measured. */
+void test_remote_stats() {
+    Cluster cluster(3);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, 3, cfg);
+        KVStore* kv = kd.get_kv();
+        size_t peer = (idx + 1) % 3;
+        const char* remote = kv->stats(peer);
+        char header[32];
+        snprintf(header, sizeof(header), "node %zu\n", peer);
+        assert(strncmp(remote, header, strlen(header)) == 0);
+        delete[] remote;
+        const char* local = kv->stats(idx);
+        char sent[32];
+        snprintf(sent, sizeof(sent), "sent Stats %zu 1 ", peer);
+        assert(strstr(local, sent) != nullptr);
+        assert(strstr(local, "latency Stats count 1 ") != nullptr);
+        delete[] local;
+        kd.barrier();
+        kd.done();
+    });
+}
+
+/**
+ * A node refuses a message larger than its KVConfig::max_frame_bytes_ before allocating anything
+ * for it, and drops the stream it came on, which shuts both nodes down.
+ */
+void test_oversized_frame() {
+    Cluster cluster(2);
+    cluster.run([](size_t idx, KVConfig cfg) {
+        if (idx == 0) cfg.max_frame_bytes_ = 1024;
+        KDStore kd(idx, 2, cfg);
+        KVStore* kv = kd.get_kv();
+        kv->barrier();
+        if (idx == 1) {
+            char big[4096];
+            memset(big, 'x', sizeof(big) - 1);
+            big[sizeof(big) - 1] = '\0';
+            Reply r(big, MsgKind::Get, 0);
+            const char* msg = r.serialize_meta();
+            kv->send_to_node_(msg, 0, big);
+            delete[] msg;
+        }
+        while (!kv->has_shutdown) usleep(1000);
+        kd.done();
+    });
+}
+
+/** Joins two values with a comma, to check the order that reduce() combines them in. */
+const char* join(const char* a, const char* b) {
+    StrBuff buff;
+    buff.c(a).c(",").c(b);
+    return buff.c_str();
+}
+
+/**
+ * Broadcast, reduce, and allgather hand every node the right values on clusters whose sizes are
+ * and are not powers of two, from a root that is not node 0, and after a barrier every node sees
+ * what the others put before it.
+ */
+void test_collectives(size_t nodes) {
+    Cluster cluster(nodes);
+    cluster.run([nodes](size_t idx, KVConfig cfg) {
+        KDStore kd(idx, nodes, cfg);
+        KVStore* kv = kd.get_kv();
+        size_t root = nodes / 2;
+        char name[16];
+        snprintf(name, sizeof(name), "n%zu", idx);
+        // broadcast
+        Blob b = kv->broadcast(idx == root ? kv->duplicate("from the root") : nullptr, root);
+        assert(strcmp(b.c_str(), "from the root") == 0);
+        // reduce, combining in node order counting from the root
+        Blob r = kv->reduce(kv->duplicate(name), join, root);
+        if (idx == root) {
+            StrBuff expected;
+            for (size_t i = 0; i < nodes; i++) {
+                if (i > 0) expected.c(",");
+                expected.c("n").c((root + i) % nodes);
+            }
+            char* e = expected.c_str();
+            assert(strcmp(r.c_str(), e) == 0);
+            delete[] e;
+        } else {
+            assert(r.empty());
+        }
+        // allgather, with values that look like the "{n}" fields around them
+        StrBuff v;
+        v.c("{").c(idx).c("}").c(name);
+        Blob* all = kv->allgather(v.c_str());
+        for (size_t i = 0; i < nodes; i++) {
+            char e[32];
+            snprintf(e, sizeof(e), "{%zu}n%zu", i, i);
+            assert(strcmp(all[i].c_str(), e) == 0);
+        }
+        delete[] all;
+        // barrier
+        Key k(name, (idx + 1) % nodes);
+        kv->put_async(k, kv->duplicate("I{1}"));
+        kd.barrier();
+        for (size_t i = 0; i < nodes; i++) {
+            snprintf(name, sizeof(name), "n%zu", i);
+            Key other(name, (i + 1) % nodes);
+            assert(!kv->get(other).empty());
+        }
+        // A frame is shared by its metadata, and read from where its chunks are
+        Key fk("shared", root);
+        DataFrame* df = nullptr;
+        if (idx == root) {
+            int vals[] = { 1, 2, 3 };
+            df = DataFrame::fromIntArray(&fk, &kd, 3, vals);
+        }
+        DataFrame* shared = kd.broadcast(fk, df, root);
+        assert(shared->nrows() == 3 && shared->get_int(0, 2) == 3);
+        delete shared;
+        kd.done();
+    });
+}
+
+/** The same seed draws the same delays, and each stays within the jitter. */
+void test_cost_model() {
+    LoopbackTransport a(100, 50, 1000000, 7);
+    LoopbackTransport b(100, 50, 1000000, 7);
+    LoopbackTransport c(100, 50, 1000000, 8);
+    bool differs = false;
+    for (size_t seq = 0; seq < 100; seq++) {
+        size_t d = a.latency_us(0, 1, seq);
+        assert(d >= 100 && d <= 150);
+        assert(d == b.latency_us(0, 1, seq));
+        if (d != c.latency_us(0, 1, seq)) differs = true;
+    }
+    assert(differs);
+    // 1MB/s moves a byte every microsecond
+    assert(a.transmit_us(2500) == 2500);
+    LoopbackTransport none;
+    assert(none.latency_us(0, 1, 0) == 0 && none.transmit_us(1 << 20) == 0);
+}
+
+int main() {
+    test_cost_model();
+    test_ring_of_frames();
+    test_latency();
+    test_replication();
+    test_chunk_cache();
+    test_read_ahead();
+    test_remote_stats();
+    test_oversized_frame();
+    test_collectives(1);
+    test_collectives(4);
+    test_collectives(7);
+    printf("Cluster tests passed.\n");
+    return 0;
+}
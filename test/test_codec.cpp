@@ -0,0 +1,89 @@
+#include "../src/kvstore.h"
+#include <assert.h>
+
+/** Compresses and decompresses the given value and checks that it comes back unchanged. */
+void round_trip(const char* v) {
+    char* c = Codec::compress(v, strlen(v));
+    if (c == nullptr) {
+        // Only values that would not get smaller are left alone
+        assert(v[0] != CODEC_MARKER);
+        return;
+    }
+    assert(Codec::is_compressed(c));
+    assert(strlen(c) + 1 <= Codec::bound(strlen(v)));
+    char* d = Codec::decompress(c);
+    assert(strcmp(d, v) == 0);
+    delete[] c; delete[] d;
+}
+
+void test_codec() {
+    // Repetitive text, like a serialized chunk, gets much smaller
+    StrBuff buff;
+    for (size_t i = 0; i < 1000; i++) buff.c("I{12345}");
+    char* chunk = buff.c_str();
+    char* c = Codec::compress(chunk, strlen(chunk));
+    assert(c != nullptr);
+    assert(strlen(c) * 10 < strlen(chunk));
+    char* d = Codec::decompress(c);
+    assert(strcmp(d, chunk) == 0);
+    delete[] c; delete[] d; delete[] chunk;
+
+    // Short values, values with long overlapping runs, and values with no repeats
+    round_trip("");
+    round_trip("S{3}foo");
+    char run[5000];
+    memset(run, 'a', sizeof(run) - 1);
+    run[sizeof(run) - 1] = '\0';
+    round_trip(run);
+    char noise[3000];
+    unsigned x = 7;
+    for (size_t i = 0; i < sizeof(noise) - 1; i++) {
+        x = x * 1103515245 + 12345;
+        noise[i] = (char)(1 + (x >> 16) % 255);
+    }
+    noise[sizeof(noise) - 1] = '\0';
+    round_trip(noise);
+
+    // A value that starts with the marker is always compressed
+    char marked[] = "\x01 not actually compressed";
+    c = Codec::compress(marked, strlen(marked));
+    assert(c != nullptr);
+    d = Codec::decompress(c);
+    assert(strcmp(d, marked) == 0);
+    delete[] c; delete[] d;
+}
+
+void test_compressed_store() {
+    // Values come back out of a compressing store exactly as they went in
+    Sys s;
+    KVConfig cfg;
+    cfg.compress_ = true;
+    KVStore* kv = new KVStore(0, 1, cfg);
+    StrBuff buff;
+    for (size_t i = 0; i < 500; i++) buff.c("F{2.5}");
+    char* chunk = buff.c_str();
+    Key k("chunk", 0);
+    kv->put(k, s.duplicate(chunk));
+    Blob v = kv->get(k);
+    assert(strcmp(v.c_str(), chunk) == 0);
+    v = kv->wait_and_get(k);
+    assert(strcmp(v.c_str(), chunk) == 0);
+    // The map holds the compressed form
+    Blob stored = kv->get_stored_(k);
+    assert(Codec::is_compressed(stored.c_str()) && stored.size() < strlen(chunk));
+    // Values that do not shrink are stored as they are
+    Key small("small", 0);
+    kv->put(small, s.duplicate("I{1}"));
+    stored = kv->get_stored_(small);
+    assert(strcmp(stored.c_str(), "I{1}") == 0);
+    delete[] chunk;
+    kv->shutdown();
+    delete kv;
+}
+
+int main() {
+    test_codec();
+    test_compressed_store();
+    printf("Codec tests passed.\n");
+    return 0;
+}
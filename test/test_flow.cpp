@@ -0,0 +1,81 @@
+#include "../src/flow.h"
+#include <assert.h>
+#include <thread>
+#include <unistd.h>
+
+void test_message_window() {
+    FlowWindow w;
+    w.limit(2, 0);
+    w.acquire(10);
+    w.acquire(10);
+    assert(w.msgs_ == 2 && w.bytes_ == 20 && w.stalls_ == 0);
+    // The third request waits until one of the first two is answered
+    std::atomic<bool> sent(false);
+    std::thread t([&]() {
+        w.acquire(10);
+        sent = true;
+    });
+    usleep(20000);
+    assert(!sent);
+    w.release(10);
+    t.join();
+    assert(sent && w.msgs_ == 2 && w.stalls_ == 1 && w.stall_us_ > 0);
+}
+
+void test_byte_window() {
+    FlowWindow w;
+    w.limit(0, 100);
+    w.acquire(60);
+    std::atomic<bool> sent(false);
+    std::thread t([&]() {
+        w.acquire(60);
+        sent = true;
+    });
+    usleep(20000);
+    assert(!sent);
+    w.release(60);
+    t.join();
+    assert(sent && w.bytes_ == 60);
+    w.release(60);
+    // A request bigger than the whole window goes once nothing else is outstanding
+    w.acquire(500);
+    assert(w.bytes_ == 500 && w.stalls_ == 1);
+    w.release(500);
+}
+
+void test_read_estimate() {
+    FlowWindow w;
+    assert(w.read_estimate(2) == 2 * DEFAULT_READ_VALUE_BYTES);
+    // Replies of much smaller values bring the estimate down to their size
+    for (size_t i = 0; i < 50; i++) w.settle_read(4, 4 * 100);
+    assert(w.read_estimate(1) >= 100 && w.read_estimate(1) < 200);
+    // and of larger ones back up
+    for (size_t i = 0; i < 50; i++) w.settle_read(1, 1000000);
+    assert(w.read_estimate(1) > 900000 && w.read_estimate(1) <= 1000000);
+    // Requests that read nothing, such as Puts, leave it alone
+    size_t before = w.read_estimate(1);
+    w.settle_read(0, 0);
+    assert(w.read_estimate(1) == before);
+}
+
+void test_close() {
+    FlowWindow w;
+    w.limit(1, 0);
+    w.acquire(0);
+    std::thread t([&]() { w.acquire(0); });
+    usleep(20000);
+    // Shutting down lets the waiting request through
+    w.close();
+    t.join();
+    w.acquire(0);
+    assert(w.msgs_ == 3);
+}
+
+int main() {
+    test_message_window();
+    test_byte_window();
+    test_read_estimate();
+    test_close();
+    printf("Flow control tests passed.\n");
+    return 0;
+}
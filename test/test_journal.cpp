@@ -0,0 +1,123 @@
+#include "../src/kvstore.h"
+#include <assert.h>
+
+// The directory the tests keep their journals in
+#define DIR "/tmp/eau2_test_journal"
+
+/** Deletes every file that a journal for node 0 may have left in DIR. */
+void clean() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/node-0.snap", DIR);
+    remove(path);
+    for (size_t gen = 0; gen < 64; gen++) {
+        snprintf(path, sizeof(path), "%s/node-0.log.%zu", DIR, gen);
+        remove(path);
+    }
+}
+
+/** Checks that the given map holds the given value at the given key. */
+void check(ShardedMap& map, const char* key, const char* value) {
+    String k(key);
+    Blob v = map.get(k);
+    assert(!v.empty());
+    assert(strcmp(v.c_str(), value) == 0);
+}
+
+/** Puts the given value into the given map and journal, the way the KVStore does. */
+void put(ShardedMap& map, Journal& j, const char* key, const char* value) {
+    Sys s;
+    String k(key);
+    Blob v(s.duplicate(value));
+    map.put(k, v);
+    bool full = j.append(k, v);
+    j.flush();
+    if (full) j.snapshot(map);
+}
+
+void test_log_and_snapshot() {
+    clean();
+    // A tiny threshold, so that a snapshot is taken partway through
+    Journal* j = new Journal(DIR, 0, 200);
+    ShardedMap map(4);
+    assert(j->recover(map) == 0);
+    put(map, *j, "a", "I{1}");
+    put(map, *j, "b", "I{2}");
+    put(map, *j, "a", "I{3}");
+    for (size_t i = 0; i < 20; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "k%zu", i);
+        put(map, *j, key, "S{12}hello world!");
+    }
+    assert(j->gen_ > 0);
+    put(map, *j, "b", "I{4}");
+    delete j;
+
+    // A restart loads the snapshot and then the log after it
+    j = new Journal(DIR, 0, 200);
+    ShardedMap restored(8);
+    assert(j->recover(restored) > 0);
+    check(restored, "a", "I{3}");
+    check(restored, "b", "I{4}");
+    check(restored, "k19", "S{12}hello world!");
+    // Values from the snapshot are used where they are mapped, and the log's are copied
+    String k0("k0"), b("b");
+    assert(restored.get(k0).external());
+    assert(!restored.get(b).external());
+    delete j;
+}
+
+void test_torn_record() {
+    clean();
+    Journal* j = new Journal(DIR, 0, DEFAULT_SNAPSHOT_BYTES);
+    ShardedMap map(1);
+    j->recover(map);
+    put(map, *j, "whole", "I{1}");
+    // Half of a record, as if the node crashed while writing it
+    uint64_t lens[2] = { 4, 100 };
+    j->write_all_(j->log_fd_, (const char*)lens, sizeof(lens));
+    j->write_all_(j->log_fd_, "torn", 4);
+    delete j;
+
+    j = new Journal(DIR, 0, DEFAULT_SNAPSHOT_BYTES);
+    ShardedMap restored(1);
+    assert(j->recover(restored) == 1);
+    check(restored, "whole", "I{1}");
+    String torn("torn");
+    assert(!restored.contains(torn));
+    // New records go where the torn one was
+    put(restored, *j, "after", "I{2}");
+    delete j;
+    j = new Journal(DIR, 0, DEFAULT_SNAPSHOT_BYTES);
+    ShardedMap again(1);
+    assert(j->recover(again) == 2);
+    check(again, "after", "I{2}");
+    delete j;
+}
+
+void test_restart_store() {
+    clean();
+    Sys s;
+    KVConfig cfg;
+    cfg.data_dir_ = DIR;
+    KVStore* kv = new KVStore(0, 1, cfg);
+    Key k("frame", 0);
+    kv->put(k, s.duplicate("S{5}saved"));
+    kv->done();
+    delete kv;
+
+    kv = new KVStore(0, 1, cfg);
+    assert(kv->has_local(k));
+    Blob v = kv->get(k);
+    assert(strcmp(v.c_str(), "S{5}saved") == 0);
+    kv->shutdown();
+    delete kv;
+    clean();
+}
+
+int main() {
+    test_log_and_snapshot();
+    test_torn_record();
+    test_restart_store();
+    printf("Journal tests passed.\n");
+    return 0;
+}
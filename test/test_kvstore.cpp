@@ -129,45 +129,56 @@ int main(int argc, char** argv) {
     KVStore* kv_ = kd_->get_kv();
 
     /* Testing get() method in KVStore. */
-    const char* serial_df_f1 = kv_->get(key1);
+    Blob serial_df_f1 = kv_->get(key1);
     const char* serial_df_f2 = df_f->serialize();
-    assert(strcmp(serial_df_f1, serial_df_f2) == 0);
-    delete[] serial_df_f1; delete[] serial_df_f2;
+    assert(strcmp(serial_df_f1.c_str(), serial_df_f2) == 0);
+    delete[] serial_df_f2;
 
-    const char* serial_df_b1 = kv_->get(key2);
+    Blob serial_df_b1 = kv_->get(key2);
     const char* serial_df_b2 = df_b->serialize();
-    assert(strcmp(serial_df_b1, serial_df_b2) == 0);
-    delete[] serial_df_b1; delete[] serial_df_b2;
+    assert(strcmp(serial_df_b1.c_str(), serial_df_b2) == 0);
+    delete[] serial_df_b2;
 
-    const char* serial_df_i1 = kv_->get(key3);
+    Blob serial_df_i1 = kv_->get(key3);
     const char* serial_df_i2 = df_i->serialize();
-    assert(strcmp(serial_df_i1, serial_df_i2) == 0);
-    delete[] serial_df_i1; delete[] serial_df_i2;
+    assert(strcmp(serial_df_i1.c_str(), serial_df_i2) == 0);
+    delete[] serial_df_i2;
 
-    const char* serial_df_s1 = kv_->get(key4);
+    Blob serial_df_s1 = kv_->get(key4);
     const char* serial_df_s2 = df_s->serialize();
-    assert(strcmp(serial_df_s1, serial_df_s2) == 0);
-    delete[] serial_df_s1; delete[] serial_df_s2;
+    assert(strcmp(serial_df_s1.c_str(), serial_df_s2) == 0);
+    delete[] serial_df_s2;
 
-    const char* serial_df_floats1 = kv_->get(key5);
+    Blob serial_df_floats1 = kv_->get(key5);
     const char* serial_df_floats2 = df_floats->serialize();
-    assert(strcmp(serial_df_floats1, serial_df_floats2) == 0);
-    delete[] serial_df_floats1; delete[] serial_df_floats2;
+    assert(strcmp(serial_df_floats1.c_str(), serial_df_floats2) == 0);
+    delete[] serial_df_floats2;
 
-    const char* serial_df_bools1 = kv_->get(key6);
+    Blob serial_df_bools1 = kv_->get(key6);
     const char* serial_df_bools2 = df_bools->serialize();
-    assert(strcmp(serial_df_bools1, serial_df_bools2) == 0);
-    delete[] serial_df_bools1; delete[] serial_df_bools2;
+    assert(strcmp(serial_df_bools1.c_str(), serial_df_bools2) == 0);
+    delete[] serial_df_bools2;
 
-    const char* serial_df_ints1 = kv_->get(key7);
+    Blob serial_df_ints1 = kv_->get(key7);
     const char* serial_df_ints2 = df_ints->serialize();
-    assert(strcmp(serial_df_ints1, serial_df_ints2) == 0);
-    delete[] serial_df_ints1; delete[] serial_df_ints2;
+    assert(strcmp(serial_df_ints1.c_str(), serial_df_ints2) == 0);
+    delete[] serial_df_ints2;
 
-    const char* serial_df_strings1 = kv_->get(key8);
+    Blob serial_df_strings1 = kv_->get(key8);
     const char* serial_df_strings2 = df_strings->serialize();
-    assert(strcmp(serial_df_strings1, serial_df_strings2) == 0);
-    delete[] serial_df_strings1; delete[] serial_df_strings2;
+    assert(strcmp(serial_df_strings1.c_str(), serial_df_strings2) == 0);
+    delete[] serial_df_strings2;
+
+    /* Local gets share the map's bytes, and outlive a put that replaces them. */
+    Blob shared = kv_->get(key1);
+    assert(shared.c_str() == serial_df_f1.c_str());
+    assert(shared.refs() == 3);
+    Key replaced("replaced", 0);
+    kv_->put(replaced, kv_->duplicate("I{1}"));
+    Blob old = kv_->get(replaced);
+    kv_->put(replaced, kv_->duplicate("I{2}"));
+    assert(old.refs() == 1 && strcmp(old.c_str(), "I{1}") == 0);
+    assert(strcmp(kv_->get(replaced).c_str(), "I{2}") == 0);
 
     kd_->done();
     delete kd_;
@@ -113,9 +113,6 @@ int main(int argc, char** argv) {
     s.p("Node ", idx).p(idx, idx).pln(": Local map test passed.", idx);
 
     delete ints;
-    if (idx == 0) {
-        sleep(2);
-        kd.done();
-    }
+    kd.done();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "../src/membership.h"
+#include <assert.h>
+
+int main() {
+    // Addresses with and without a port
+    Membership m(3);
+    assert(!m.known(0));
+    m.set(0, "10.0.0.7:9001");
+    m.set(1, "node-b");
+    assert(m.known(0) && m.known(1) && !m.known(2));
+    assert(strcmp(m.host(0), "10.0.0.7") == 0);
+    assert(strcmp(m.port(0), "9001") == 0);
+    assert(strcmp(m.host(1), "node-b") == 0);
+    assert(strcmp(m.port(1), DEFAULT_PORT) == 0);
+    char* addr = m.address(0);
+    assert(strcmp(addr, "10.0.0.7:9001") == 0);
+    delete[] addr;
+    // Replacing an address
+    m.set(0, "127.0.0.1:9100");
+    assert(strcmp(m.port(0), "9100") == 0);
+
+    // The default layout
+    addr = Membership::default_address(2);
+    assert(strcmp(addr, "127.0.0.3:8080") == 0);
+    delete[] addr;
+
+    // Reading a file with comments, blank lines, and nodes out of order
+    const char* path = "/tmp/eau2_test_membership.txt";
+    FILE* f = fopen(path, "w");
+    assert(f != nullptr);
+    fprintf(f, "# three nodes on one host\n\n2 127.0.0.1:9102\n  0 127.0.0.1:9100\n1 127.0.0.1\n");
+    fclose(f);
+    Membership* fm = Membership::from_file(path, 3);
+    assert(fm->size() == 3);
+    assert(strcmp(fm->port(0), "9100") == 0);
+    assert(strcmp(fm->port(1), DEFAULT_PORT) == 0);
+    assert(strcmp(fm->host(2), "127.0.0.1") == 0);
+    assert(strcmp(fm->port(2), "9102") == 0);
+    delete fm;
+    remove(path);
+
+    printf("Membership tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "../src/placement.h"
+#include <assert.h>
+
+// The number of chunk keys placed in the tests
+#define KEYS 20000
+
+/** Writes the key of the given chunk of a column named "col" to the given buffer. */
+void chunk_key(char* buf, size_t size, size_t chunk) {
+    snprintf(buf, size, "col-c0-%zu", chunk);
+}
+
+void test_modulo() {
+    ModuloPlacement p(3);
+    char key[32];
+    for (size_t i = 0; i < 10; i++) {
+        chunk_key(key, sizeof(key), i);
+        assert(p.home(key, i, 2) == i % 3);
+    }
+}
+
+void test_ring_balance() {
+    RingPlacement p(4, DEFAULT_RING_VNODES);
+    size_t counts[4] = { 0, 0, 0, 0 };
+    char key[32];
+    for (size_t i = 0; i < KEYS; i++) {
+        chunk_key(key, sizeof(key), i);
+        size_t home = p.home(key, i, 0);
+        assert(home < 4);
+        // The same key always goes to the same node
+        assert(p.home(key, i, 3) == home);
+        counts[home]++;
+    }
+    // Every node gets within half of its fair share
+    for (size_t n = 0; n < 4; n++) {
+        assert(counts[n] > KEYS / 8 && counts[n] < KEYS * 3 / 8);
+    }
+}
+
+void test_ring_growth() {
+    RingPlacement before(4, DEFAULT_RING_VNODES);
+    RingPlacement after(5, DEFAULT_RING_VNODES);
+    size_t moved = 0;
+    char key[32];
+    for (size_t i = 0; i < KEYS; i++) {
+        chunk_key(key, sizeof(key), i);
+        size_t old_home = before.home(key, i, 0);
+        size_t new_home = after.home(key, i, 0);
+        if (old_home == new_home) continue;
+        // The only chunks that move are the ones the new node takes over
+        assert(new_home == 4);
+        moved++;
+    }
+    // About a fifth of the chunks move, where modulo placement would move four fifths
+    assert(moved > KEYS / 10 && moved < KEYS * 3 / 10);
+}
+
+void test_sized() {
+    SizedPlacement p(4, 2, new RingPlacement(4, DEFAULT_RING_VNODES));
+    RingPlacement ring(4, DEFAULT_RING_VNODES);
+    char key[32];
+    for (size_t i = 0; i < 100; i++) {
+        chunk_key(key, sizeof(key), i);
+        if (i < 2) assert(p.home(key, i, 3) == 3);
+        else assert(p.home(key, i, 3) == ring.home(key, i, 3));
+    }
+    assert(p.home_of("users-1-0") == ring.home_of("users-1-0"));
+}
+
+void test_make() {
+    KVConfig cfg;
+    PlacementPolicy* p = PlacementPolicy::make(cfg, 3);
+    assert(dynamic_cast<ModuloPlacement*>(p) != nullptr);
+    delete p;
+    cfg.placement_ = Placement::Ring;
+    p = PlacementPolicy::make(cfg, 3);
+    assert(dynamic_cast<RingPlacement*>(p) != nullptr);
+    delete p;
+    cfg.placement_ = Placement::Sized;
+    cfg.small_chunks_ = 1;
+    p = PlacementPolicy::make(cfg, 3);
+    SizedPlacement* sized = dynamic_cast<SizedPlacement*>(p);
+    assert(sized != nullptr && sized->small_chunks_ == 1);
+    delete p;
+}
+
+int main() {
+    test_modulo();
+    test_ring_balance();
+    test_ring_growth();
+    test_sized();
+    test_make();
+    printf("Placement tests passed.\n");
+    return 0;
+}
@@ -108,7 +108,7 @@ void test_string_vector_serialization() {
 
 void test_message_serialization(KVStore* kv) {
     /* Ack construction */
-    Ack* ack = new Ack();
+    Ack* ack = new Ack(7);
 
     /* Ack serialization */
     const char* serialized_ack = ack->serialize();
@@ -164,7 +164,7 @@ void test_message_serialization(KVStore* kv) {
     Key* key1 = new Key("foo",0);
     DataFrame* df = df_(kv, key1);
     const char* serial_df = df->serialize();
-    Put* put = new Put(key1, serial_df);
+    Put* put = new Put(key1, serial_df, 1);
 
     /* Put serialization */
     const char* serialized_put = put->serialize();
@@ -184,7 +184,7 @@ void test_message_serialization(KVStore* kv) {
 
     /* Get construction */
     Key* key2 = new Key("foo", 0);
-    Get* get = new Get(key2);
+    Get* get = new Get(key2, 2);
 
     /* Get serialization */
     const char* serialized_get = get->serialize();
@@ -203,7 +203,7 @@ void test_message_serialization(KVStore* kv) {
 
     /* WaitAndGet construction */
     Key* key3 = new Key("foo", 0);
-    WaitAndGet* w_get = new WaitAndGet(key3);
+    WaitAndGet* w_get = new WaitAndGet(key3, 3);
 
     /* WaitAndGet serialization */
     const char* serialized_w_get = w_get->serialize();
@@ -222,7 +222,7 @@ void test_message_serialization(KVStore* kv) {
 
     /* Reply construction */
     const char* serial_df2 = df->serialize();
-    Reply* rep = new Reply(serial_df2, MsgKind::Get);
+    Reply* rep = new Reply(serial_df2, MsgKind::Get, 2);
 
     /* Reply serialization */
     const char* serialized_reply = rep->serialize();
@@ -240,6 +240,108 @@ void test_message_serialization(KVStore* kv) {
     delete[] serialized_reply;
     delete[] deserialized_reply->get_value();
     delete deserialized_reply;
+
+    /* MultiPut construction */
+    Key** mkeys = new Key*[2];
+    mkeys[0] = new Key("a", 1);
+    mkeys[1] = new Key("b", 1);
+    const char** mvalues = new const char*[2];
+    mvalues[0] = "I{1}";
+    mvalues[1] = "S{3}foo";
+    MultiPut* mput = new MultiPut(mkeys, mvalues, 2, 4);
+
+    /* MultiPut serialization and deserialization */
+    const char* serialized_mput = mput->serialize();
+    Deserializer mput_deserializer(serialized_mput);
+    MultiPut* deserialized_mput = mput_deserializer.deserialize_message()->as_multi_put();
+    assert(deserialized_mput != nullptr);
+    assert(deserialized_mput->equals(mput));
+    for (size_t i = 0; i < 2; i++) delete deserialized_mput->get_key(i);
+    delete deserialized_mput;
+    delete[] serialized_mput;
+
+    /* MultiGet construction, serialization, and deserialization */
+    Key** gkeys = new Key*[2];
+    gkeys[0] = mkeys[0];
+    gkeys[1] = mkeys[1];
+    MultiGet* mget = new MultiGet(gkeys, 2, 5);
+    const char* serialized_mget = mget->serialize();
+    Deserializer mget_deserializer(serialized_mget);
+    MultiGet* deserialized_mget = mget_deserializer.deserialize_message()->as_multi_get();
+    assert(deserialized_mget != nullptr);
+    assert(deserialized_mget->equals(mget));
+    for (size_t i = 0; i < 2; i++) delete deserialized_mget->get_key(i);
+    delete deserialized_mget;
+    delete[] serialized_mget;
+
+    /* MultiReply construction, serialization, and deserialization, with the values received
+     * apart from the rest of the message like the KVStore does */
+    const char** rvalues = new const char*[2];
+    rvalues[0] = mvalues[0];
+    rvalues[1] = mvalues[1];
+    MultiReply* mrep = new MultiReply(rvalues, 2, 5);
+    const char* serialized_mrep = mrep->serialize_meta();
+    Sys sys;
+    // Each value arrives followed by its terminator
+    char* received = new char[13];
+    memcpy(received, "I{1}\0S{3}foo\0", 13);
+    Deserializer mrep_deserializer(serialized_mrep, received);
+    MultiReply* deserialized_mrep = mrep_deserializer.deserialize_message()->as_multi_reply();
+    assert(deserialized_mrep != nullptr);
+    assert(deserialized_mrep->equals(mrep));
+    // The values are used in place, in the buffer that they were received in
+    Blob* rblobs = deserialized_mrep->steal_blobs();
+    assert(rblobs[0].c_str() == received && rblobs[1].c_str() == received + 5);
+    assert(rblobs[1].size() == 7);
+    delete deserialized_mrep;
+    // The buffer outlives the message for as long as a handle to one of its values does
+    Blob kept = rblobs[1];
+    delete[] rblobs;
+    assert(strcmp(kept.c_str(), "S{3}foo") == 0);
+    delete[] serialized_mrep;
+
+    /* Barrier construction, serialization, and deserialization */
+    Barrier* bar = new Barrier(3, 2);
+    const char* serialized_bar = bar->serialize();
+    Deserializer bar_deserializer(serialized_bar);
+    Barrier* deserialized_bar = bar_deserializer.deserialize_message()->as_barrier();
+    assert(deserialized_bar != nullptr);
+    assert(deserialized_bar->equals(bar));
+    delete deserialized_bar;
+    delete[] serialized_bar;
+    delete bar;
+
+    /* Collective construction, serialization, and deserialization, with the value received
+     * apart from the rest of the message like the KVStore does */
+    Collective* col = new Collective(4, 1, "{2}{5}{9}");
+    const char* serialized_col = col->serialize_meta();
+    Deserializer col_deserializer(serialized_col, sys.duplicate("{2}{5}{9}"));
+    Collective* deserialized_col = col_deserializer.deserialize_message()->as_collective();
+    assert(deserialized_col != nullptr);
+    assert(deserialized_col->equals(col));
+    assert(strcmp(kind_name((size_t)MsgKind::Collective), "Collective") == 0);
+    delete[] deserialized_col->get_value();
+    delete deserialized_col;
+    delete[] serialized_col;
+    delete col;
+
+    /* Stats construction, serialization, and deserialization */
+    Stats* st = new Stats(7);
+    const char* serialized_st = st->serialize();
+    Deserializer st_deserializer(serialized_st);
+    Stats* deserialized_st = st_deserializer.deserialize_message()->as_stats();
+    assert(deserialized_st != nullptr);
+    assert(deserialized_st->equals(st));
+    assert(strcmp(kind_name((size_t)MsgKind::Stats), "Stats") == 0);
+    delete deserialized_st;
+    delete[] serialized_st;
+    delete st;
+
+    delete mkeys[0];
+    delete mkeys[1];
+    delete mput;
+    delete mget;
+    delete mrep;
 }
 
 void test_object_serialization() {
@@ -0,0 +1,98 @@
+#include "../src/kvstore.h"
+#include <assert.h>
+
+// The size of every value in the tests, several pages
+#define VALUE_SIZE 16384
+// The number of values put in the tests
+#define VALUES 32
+
+/** Returns a value of VALUE_SIZE bytes that is different for every given number. */
+char* make_value(size_t n) {
+    char* v = new char[VALUE_SIZE + 1];
+    memset(v, 'a' + n % 26, VALUE_SIZE);
+    snprintf(v, 16, "S{%zu}", n);
+    v[strlen(v)] = 'x';
+    v[VALUE_SIZE] = '\0';
+    return v;
+}
+
+/** Checks that the given handle holds the value that make_value() makes for the given number. */
+void check(Blob& v, size_t n) {
+    char* expected = make_value(n);
+    assert(v.size() == VALUE_SIZE);
+    assert(strcmp(v.c_str(), expected) == 0);
+    delete[] expected;
+}
+
+void test_map_budget() {
+    ShardedMap map(4);
+    map.set_budget(4 * VALUE_SIZE, "/tmp", 0);
+    String** keys = new String*[VALUES];
+    for (size_t i = 0; i < VALUES; i++) {
+        StrBuff buff("key-");
+        buff.c(i);
+        keys[i] = buff.get();
+        Blob v(make_value(i));
+        map.put(*keys[i], v);
+        assert(map.resident_ <= 4 * VALUE_SIZE);
+    }
+    assert(map.spills_ >= VALUES - 4);
+    assert(map.spill_->bytes_ == (VALUES - map.resident_ / VALUE_SIZE) * VALUE_SIZE);
+
+    // A handle to a spilled value stays good after the value is read back in
+    Blob before;
+    for (size_t i = 0; i < VALUES && before.empty(); i++) {
+        Slot_* s = dynamic_cast<Slot_*>(map.shards_[map.shard_of(*keys[i])]->get(*keys[i]));
+        if (s->spilled_) {
+            before = *s;
+            Blob after = map.get(*keys[i]);
+            assert(!after.external() && after.c_str() != before.c_str());
+            check(before, i);
+            check(after, i);
+        }
+    }
+    assert(!before.empty() && map.reloads_ == 1);
+
+    // Every value reads back, and the map stays in its budget while they do
+    for (size_t r = 0; r < 2; r++) {
+        for (size_t i = 0; i < VALUES; i++) {
+            Blob v = map.get(*keys[i]);
+            check(v, i);
+            assert(map.resident_ <= 4 * VALUE_SIZE);
+        }
+    }
+    assert(map.reloads_ > VALUES);
+    for (size_t i = 0; i < VALUES; i++) delete keys[i];
+    delete[] keys;
+}
+
+void test_store_budget() {
+    KVConfig cfg;
+    cfg.memory_budget_ = 8 * VALUE_SIZE;
+    KVStore* kv = new KVStore(0, 1, cfg);
+    for (size_t i = 0; i < VALUES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "chunk-%zu", i);
+        Key k(name, 0);
+        kv->put(k, make_value(i));
+    }
+    assert(kv->resident_bytes() <= 8 * VALUE_SIZE);
+    assert(kv->spills() > 0 && kv->spilled_bytes() > 0);
+    for (size_t i = 0; i < VALUES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "chunk-%zu", i);
+        Key k(name, 0);
+        Blob v = kv->get(k);
+        check(v, i);
+    }
+    assert(kv->reloads() > 0);
+    kv->shutdown();
+    delete kv;
+}
+
+int main() {
+    test_map_budget();
+    test_store_budget();
+    printf("Spill tests passed.\n");
+    return 0;
+}
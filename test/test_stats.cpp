@@ -0,0 +1,83 @@
+#include "../src/stats.h"
+#include <assert.h>
+#include <string.h>
+
+/** Names kinds by number, like kind_name() in message.h does. */
+const char* number_name(size_t kind) {
+    static char names[MSG_KINDS + 1][8];
+    snprintf(names[kind], sizeof(names[kind]), "K%zu", kind);
+    return names[kind];
+}
+
+void test_histogram() {
+    LatencyHistogram h;
+    assert(h.percentile(0.5) == 0);
+    for (size_t i = 0; i < 99; i++) h.record(10);
+    h.record(5000);
+    assert(h.count_ == 100 && h.total_us_ == 99 * 10 + 5000);
+    // 10us falls in the bucket that ends at 16us, and 5000us in the one that ends at 8192us
+    assert(h.percentile(0.5) == 16);
+    assert(h.percentile(0.98) == 16);
+    assert(h.percentile(0.995) == 8192);
+    // Latencies longer than the last bucket all land in it
+    h.record((size_t)-1);
+    assert(h.buckets_[LATENCY_BUCKETS - 1] == 1);
+}
+
+void test_hot_keys() {
+    HotKeys hot;
+    // One key read far more than the others stays in the table, however many others there are
+    for (size_t i = 0; i < 1000; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "cold-%zu", i);
+        hot.hit(key);
+        if (i % 4 == 0) hot.hit("hot");
+    }
+    assert(hot.top_.size() == HOT_KEYS);
+    StrBuff buff;
+    hot.report(buff);
+    char* report = buff.c_str();
+    // The hottest key is reported first, with at least as many reads as it really had
+    assert(strncmp(report, "hot hot ", 8) == 0);
+    assert(strtoul(report + 8, nullptr, 10) >= 250);
+    delete[] report;
+}
+
+void test_report() {
+    NodeStats stats(1, 3);
+    stats.sent(3, 0, 100);
+    stats.sent(3, 0, 50);
+    stats.received(2, 0, 400);
+    // Traffic from a socket whose node is not known yet
+    stats.received(5, (size_t)-1, 30);
+    // A kind of message that this node does not know
+    stats.received(MSG_KINDS + 4, 0, 10);
+    stats.answered(3, 0, 100);
+    stats.answered(4, (size_t)-1, 100);
+    stats.hot_.hit("users-1-0");
+    char* report = stats.report(number_name);
+    char unknown[32];
+    assert(strncmp(report, "node 1\n", 7) == 0);
+    assert(strstr(report, "sent K3 0 2 150\n") != nullptr);
+    assert(strstr(report, "recv K2 0 1 400\n") != nullptr);
+    assert(strstr(report, "recv K5 ? 1 30\n") != nullptr);
+    snprintf(unknown, sizeof(unknown), "recv K%zu 0 1 10\n", MSG_KINDS);
+    assert(strstr(report, unknown) != nullptr);
+    assert(strstr(report, "latency K3 count 1 mean_us 100 p50_us 128 p99_us 128\n") != nullptr);
+    assert(strstr(report, "latency K4 count 1 ") != nullptr);
+    // Only requests to a known node count towards its peer latency
+    assert(strstr(report, "peer 0 count 1 ") != nullptr);
+    assert(strstr(report, "peer 1") == nullptr);
+    assert(strstr(report, "hot users-1-0 1\n") != nullptr);
+    // Counters that are still zero are left out
+    assert(strstr(report, "K0") == nullptr);
+    delete[] report;
+}
+
+int main() {
+    test_histogram();
+    test_hot_keys();
+    test_report();
+    printf("Stats tests passed.\n");
+    return 0;
+}